@@ -3,7 +3,19 @@
 #include "ClamirCLR.h"
 
 namespace ClamirCLR {
-	ClamirCLR::ClamirCLR() : clamirfunc(new ClamirFunctions)
+	template <typename T, typename M>
+	static void CopyToManaged(const T* source, array<M>^% target, int n)
+	{
+		if (target == nullptr || target->Length < n)
+			target = gcnew array<M>(n);
+		if (n > 0)
+		{
+			pin_ptr<M> pinned = &target[0];
+			memcpy(pinned, source, n * sizeof(T));
+		}
+	}
+
+	ClamirCLR::ClamirCLR() : clamirfunc(new ClamirFunctions), frameblock(new FrameBlock), connection(new ConnectionManager)
 	{
 
 	};
@@ -15,6 +27,16 @@ namespace ClamirCLR {
 			delete clamirfunc;
 			clamirfunc = 0;
 		}
+		if (frameblock)
+		{
+			delete frameblock;
+			frameblock = 0;
+		}
+		if (connection)
+		{
+			delete connection;
+			connection = 0;
+		}
 
 	};
 	// - 
@@ -45,5 +67,74 @@ namespace ClamirCLR {
 		int result = clamirfunc->DisconnectDevice();
 		return result;
 	}
+	int ClamirCLR::SetDeviceAddress(String^ address)
+	{
+		IntPtr text = System::Runtime::InteropServices::Marshal::StringToHGlobalAnsi(address);
+		int result = clamirfunc->SetDeviceAddress(static_cast<const char*>(text.ToPointer()));
+		System::Runtime::InteropServices::Marshal::FreeHGlobal(text);
+		return result;
+	}
+	int ClamirCLR::StartConnection()
+	{
+		return connection->Start();
+	}
+	int ClamirCLR::StopConnection()
+	{
+		return connection->Stop();
+	}
+	int ClamirCLR::GetConnectionState()
+	{
+		return connection->State();
+	}
+	int ClamirCLR::DumpCallStats(String^ path)
+	{
+		IntPtr text = System::Runtime::InteropServices::Marshal::StringToHGlobalAnsi(path);
+		int result = DeviceCallStats::Dump(static_cast<const char*>(text.ToPointer()));
+		System::Runtime::InteropServices::Marshal::FreeHGlobal(text);
+		return result;
+	}
+	void ClamirCLR::EnableTrace(bool enabled)
+	{
+		FrameTrace::SetEnabled(enabled);
+	}
+	void ClamirCLR::TraceBegin(int stage, int frame)
+	{
+		FrameTrace::Begin(stage, frame);
+	}
+	void ClamirCLR::TraceEnd(int stage, int frame)
+	{
+		FrameTrace::End(stage, frame);
+	}
+	int ClamirCLR::ExportTrace(String^ path)
+	{
+		IntPtr text = System::Runtime::InteropServices::Marshal::StringToHGlobalAnsi(path);
+		int result = FrameTrace::Export(static_cast<const char*>(text.ToPointer()));
+		System::Runtime::InteropServices::Marshal::FreeHGlobal(text);
+		return result;
+	}
+	// One native call and one copy per field for the whole block
+	int ClamirCLR::GetFrames(int n, ClamirFrameBlock^ block)
+	{
+		int result = clamirfunc->GetFrames(n, frameblock);
+		int count = frameblock->Count;
+		block->Count = count;
+		if (count > 0)
+		{
+			TraceScope trace(TRACE_DISPLAY, frameblock->FrameNum[count - 1]);
+			CopyToManaged(frameblock->Images.data(), block->Images, count * CLAMIR_IMAGE_PIXELS);
+			CopyToManaged(frameblock->Power.data(), block->Power, count);
+			CopyToManaged(frameblock->MeltPoolArea.data(), block->MeltPoolArea, count);
+			CopyToManaged(frameblock->TrackNum.data(), block->TrackNum, count);
+			CopyToManaged(frameblock->FrameMax.data(), block->FrameMax, count);
+			CopyToManaged(frameblock->FrameNum.data(), block->FrameNum, count);
+			CopyToManaged(frameblock->Width.data(), block->Width, count);
+			CopyToManaged(frameblock->RefWidth.data(), block->RefWidth, count);
+			CopyToManaged(frameblock->Temperature.data(), block->Temperature, count);
+			CopyToManaged(frameblock->LaserStatus.data(), block->LaserStatus, count);
+			CopyToManaged(frameblock->StateMachine.data(), block->StateMachine, count);
+			CopyToManaged(frameblock->IODigitalPortStatus.data(), block->IODigitalPortStatus, count);
+		}
+		return result;
+	}
 
 }
@@ -1,13 +1,37 @@
 ﻿#pragma once
 #include "ClamirFunctions.h"
+#include "ConnectionManager.h"
+#include "DeviceCallStats.h"
+#include "FrameTrace.h"
 
 using namespace System;
 
 namespace ClamirCLR {
+	// Managed counterpart of FrameBlock. Images holds Count frames of 4096 pixels back to back
+	public ref class ClamirFrameBlock
+	{
+	public:
+		int Count;
+		array<Int16>^ Images;
+		array<int>^ Power;
+		array<int>^ MeltPoolArea;
+		array<int>^ TrackNum;
+		array<int>^ FrameMax;
+		array<int>^ FrameNum;
+		array<float>^ Width;
+		array<float>^ RefWidth;
+		array<float>^ Temperature;
+		array<SByte>^ LaserStatus;
+		array<SByte>^ StateMachine;
+		array<Int16>^ IODigitalPortStatus;
+	};
+
 	public ref class ClamirCLR
 	{
 	protected:
 		ClamirFunctions* clamirfunc;
+		FrameBlock* frameblock;
+		ConnectionManager* connection;
 
 	public:
 		ClamirCLR();
@@ -20,5 +44,18 @@ namespace ClamirCLR {
 
 		int ConnectDevice();
 		int DisconnectDevice();
+		// Background connection with automatic reconnection; GetConnectionState returns a ConnectionState value and never blocks
+		int SetDeviceAddress(String^ address);
+		int StartConnection();
+		int StopConnection();
+		int GetConnectionState();
+		// Writes the latency histograms of the CLAMIR_dll.h calls to a text file
+		int DumpCallStats(String^ path);
+		// Pipeline trace; stage is a TraceStage value. GetFrames records its copy to the managed block as the display stage
+		void EnableTrace(bool enabled);
+		void TraceBegin(int stage, int frame);
+		void TraceEnd(int stage, int frame);
+		int ExportTrace(String^ path);
+		int GetFrames(int n, ClamirFrameBlock^ block);
 	};
 }
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/**
+@brief Bit scans of the 64-bit row masks used by MeltPoolMask, ComponentLabeler and MeltPoolGeometry, and of the latencies of DeviceCallStats
+*LowestBit and HighestBit are undefined for 0, like the intrinsics they map to.
+*/
+inline int PopCount(uint64_t value)
+{
+#if defined(__GNUC__)
+	return __builtin_popcountll(value);
+#else
+	value = value - (value >> 1 & 0x5555555555555555ull);
+	value = (value & 0x3333333333333333ull) + (value >> 2 & 0x3333333333333333ull);
+	value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+	return (int)(value * 0x0101010101010101ull >> 56);
+#endif
+}
+
+inline int LowestBit(uint64_t value)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll(value);
+#elif defined(_M_X64)
+	unsigned long index;
+	_BitScanForward64(&index, value);
+	return (int)index;
+#else
+	unsigned long index;
+	if (_BitScanForward(&index, (unsigned long)value))
+		return (int)index;
+	_BitScanForward(&index, (unsigned long)(value >> 32));
+	return (int)index + 32;
+#endif
+}
+
+inline int HighestBit(uint64_t value)
+{
+#if defined(__GNUC__)
+	return 63 - __builtin_clzll(value);
+#elif defined(_M_X64)
+	unsigned long index;
+	_BitScanReverse64(&index, value);
+	return (int)index;
+#else
+	unsigned long index;
+	if (_BitScanReverse(&index, (unsigned long)(value >> 32)))
+		return (int)index + 32;
+	_BitScanReverse(&index, (unsigned long)value);
+	return (int)index;
+#endif
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+/**
+*Exports the classes of ClamirCpp when building it, whose project defines CLAMIRCPP_EXPORTS, and imports them in the projects linking it
+*/
+#ifndef _WIN32
+#define CLAMIRLIBRARY_API
+#elif defined(CLAMIRCPP_EXPORTS)
+#define CLAMIRLIBRARY_API __declspec(dllexport)
+#else
+#define CLAMIRLIBRARY_API __declspec(dllimport)
+#endif
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+#include "CLAMIR_dll.h"
+
+#define CLAMIR_IMAGE_WIDTH 64
+#define CLAMIR_IMAGE_HEIGHT 64
+#define CLAMIR_IMAGE_PIXELS (CLAMIR_IMAGE_WIDTH * CLAMIR_IMAGE_HEIGHT)
+#define CLAMIR_RAW_HEADER_BYTES 60
+#define CLAMIR_RAW_HEADER_INTS (CLAMIR_RAW_HEADER_BYTES / 4)
+#define CLAMIR_CACHE_LINE 64
+
+// Instruction sets the vectorized kernels may use, as enabled by the compiler options of the build
+#if defined(__AVX2__)
+#define CLAMIR_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CLAMIR_SSE2 1
+#endif
+
+// ImageHeader::StateMachine values
+#define CLAMIR_STATE_MANUAL 0x00
+#define CLAMIR_STATE_IDLE 0x08
+#define CLAMIR_STATE_SET_POINT 0x09
+#define CLAMIR_STATE_CONTROL 0x0A
+#define CLAMIR_STATE_PREHEATING 0x0B
+
+/**
+@struct ClamirFrame
+@brief One image and its header as delivered by GetImage, padded to whole cache lines
+*/
+struct alignas(CLAMIR_CACHE_LINE) ClamirFrame
+{
+	ImageHeader Header;
+	int16_t Image[CLAMIR_IMAGE_PIXELS];
+};
+
+/**
+@brief Allocates a block aligned to the requested power of two. Release it with ClamirAlignedFree.
+*/
+inline void* ClamirAlignedAlloc(size_t size, size_t alignment)
+{
+#ifdef _WIN32
+	return _aligned_malloc(size, alignment);
+#else
+	void* block = 0;
+	return posix_memalign(&block, alignment, size) == 0 ? block : 0;
+#endif
+}
+
+inline void ClamirAlignedFree(void* block)
+{
+#ifdef _WIN32
+	_aligned_free(block);
+#else
+	free(block);
+#endif
+}
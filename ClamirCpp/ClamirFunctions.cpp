@@ -1,12 +1,173 @@
 #include "pch.h"
 #include <utility>
 #include <limits.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
 #include "ClamirFunctions.h"
-#define CLAMIRLIBRARY_API
+#include "ConfigurationProfile.h"
+#include "DeviceCallStats.h"
+#include "FrameTrace.h"
+#include "SpscRing.h"
 
+namespace
+{
+	// Background acquisition. The ring is written only by acquisition_thread and read only by the PopFrame caller;
+	// start, stop and counter snapshots are serialized by acquisition_control.
+	// acquisition_running is cleared by StopAcquisition, or by the thread itself when it stops on a closed connection; the ring stays until StopAcquisition or the next start.
+	// PopFrame announces itself in ring_readers before loading frame_ring, and the ring is only freed once it is cleared and no reader is left.
+	std::mutex acquisition_control;
+	std::thread acquisition_thread;
+	std::atomic<bool> acquisition_running(false);
+	std::atomic<SpscRing<FrameLease>*> frame_ring(nullptr);
+	std::atomic<int> ring_readers(0);
+	FramePool* frame_pool = nullptr;
+
+	std::atomic<uint64_t> frames_acquired(0);
+	std::atomic<uint64_t> frames_dropped(0);
+	std::atomic<uint64_t> read_errors(0);
+	std::atomic<int> last_error(0);
+	std::atomic<uint32_t> ring_high_water(0);
+
+	// Parameter cache, filled by RefreshParameters and kept current by the Set functions.
+	// Writers update it while still holding the command channel, so the cache follows the order in which the device received the writes
+	std::mutex parameter_lock;
+	ParameterSnapshot parameter_cache;
+	bool parameter_cache_valid = false;
+
+	int ReadParameters(ParameterSnapshot* snapshot)
+	{
+		int result = 0;
+#define CLAMIR_READ_PARAMETER(name, type, ...) \
+		if (result == 0) \
+			result = CLAMIR_DEVICE_CALL(name##Get, &snapshot->name);
+		CLAMIR_SCALAR_PARAMETERS(CLAMIR_READ_PARAMETER)
+#undef CLAMIR_READ_PARAMETER
+		if (result == 0)
+			result = CLAMIR_DEVICE_CALL(ROICoordinatesGet, &snapshot->ROIX1, &snapshot->ROIY1, &snapshot->ROIX2, &snapshot->ROIY2);
+		if (result == 0)
+			result = CLAMIR_DEVICE_CALL(AutoShutterConfigurationGet, &snapshot->AutoShutterFlagEnable, &snapshot->AutoShutterFlagEnableInProcess,
+				&snapshot->AutoShutterFlagTemperatureDrift, &snapshot->AutoShutterFlagTimer);
+		if (result == 0)
+		{
+			// The device writes 7 characters without promising a terminator; the spare bytes keep the copy null terminated
+			char serial[64] = { 0 };
+			result = CLAMIR_DEVICE_CALL(SerialNumberGet, serial);
+			if (result == 0)
+			{
+				memset(snapshot->SerialNumber, 0, CLAMIR_SERIAL_NUMBER_SIZE);
+				memcpy(snapshot->SerialNumber, serial, CLAMIR_SERIAL_NUMBER_CHARACTERS);
+			}
+		}
+		if (result == 0)
+			result = CLAMIR_DEVICE_CALL(EmbeddedSWVersion, &snapshot->EmbeddedSWVersion);
+		return result;
+	}
+
+	void AcquisitionLoop(SpscRing<FrameLease>* ring, FramePool* pool)
+	{
+		ClamirSession& session = ClamirSession::Default();
+		FrameTrace::NameThread("acquisition");
+		// Used when the ring is full or the pool is exhausted so the socket is still drained at full rate
+		ClamirFrame overflow;
+		FrameLease lease;
+		bool linkDown = false;
+
+		while (acquisition_running.load(std::memory_order_relaxed))
+		{
+			bool leased = lease.IsValid() || pool->Acquire(&lease);
+			ClamirFrame* target = leased ? lease.Frame() : &overflow;
+
+			FrameTrace::Begin(TRACE_ACQUISITION);
+			int result = session.ReadImage(&target->Header, target->Image);
+			FrameTrace::End(TRACE_ACQUISITION, result == 0 ? target->Header.FrameNum : -1);
+			if (result == -3 && linkDown)
+			{
+				if (!session.ConnectionWatched())
+					break;
+				// Closed connections return at once; poll gently until the connection manager has reconnected
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				continue;
+			}
+			if (result != 0)
+			{
+				read_errors.fetch_add(1, std::memory_order_relaxed);
+				last_error.store(result, std::memory_order_relaxed);
+				if (result == -3)
+				{
+					// ReadImage has told the connection manager, if there is one
+					if (!session.ConnectionWatched())
+						break;
+					linkDown = true;
+				}
+				continue;
+			}
+			linkDown = false;
+
+			FrameLease* entry = ring->BeginWrite();
+			if (!entry)
+			{
+				// Keep the lease for the next read
+				frames_dropped.fetch_add(1, std::memory_order_relaxed);
+				continue;
+			}
+			if (!leased)
+			{
+				// The consumer may have released slots while we were blocked in GetImage
+				if (!pool->Acquire(&lease))
+				{
+					frames_dropped.fetch_add(1, std::memory_order_relaxed);
+					continue;
+				}
+				memcpy(lease.Frame(), &overflow, sizeof(ClamirFrame));
+			}
+			*entry = std::move(lease);
+			ring->CommitWrite();
+			frames_acquired.fetch_add(1, std::memory_order_relaxed);
+
+			uint32_t occupancy = (uint32_t)ring->Size();
+			if (occupancy > ring_high_water.load(std::memory_order_relaxed))
+				ring_high_water.store(occupancy, std::memory_order_relaxed);
+		}
+		// Publishes the last committed frame to PopFrame, which then reports the stop once the ring is drained
+		acquisition_running.store(false, std::memory_order_release);
+	}
+
+	// Joins the acquisition thread and frees the ring and the pool. Called with acquisition_control held
+	void ReleaseAcquisition()
+	{
+		acquisition_running = false;
+		if (acquisition_thread.joinable())
+			acquisition_thread.join();
+		SpscRing<FrameLease>* ring = frame_ring.exchange(nullptr);
+		while (ring_readers.load() != 0)
+			std::this_thread::yield();
+		delete ring;
+		// Leases still held by consumers keep the pool slots alive until they are released
+		delete frame_pool;
+		frame_pool = nullptr;
+	}
+
+	// Pins frame_ring for the lifetime of the object, so that StopAcquisition cannot free it meanwhile
+	class RingReader
+	{
+	public:
+		RingReader()
+		{
+			ring_readers.fetch_add(1);
+			ring = frame_ring.load();
+		}
+
+		~RingReader()
+		{
+			ring_readers.fetch_sub(1, std::memory_order_release);
+		}
 
-int connection_result = 1;
-const char* lIPAddress = "192.168.1.77";
+		SpscRing<FrameLease>* ring;
+	};
+}
 
 int ClamirFunctions::Add(int a, int b)
 {
@@ -28,13 +189,447 @@ float ClamirFunctions::Divide(float a, float b)
 	return a / b;
 }
 
+int ClamirFunctions::SetDeviceAddress(const char* address)
+{
+	return ClamirSession::Default().SetAddress(address);
+}
+
+void ClamirFunctions::DeviceAddressGet(char* address)
+{
+	ClamirSession::Default().AddressGet(address);
+}
+
+void ClamirFunctions::SetConnectionLostCallback(ConnectionLostCallback callback, void* context)
+{
+	ClamirSession::Default().SetConnectionLostCallback(callback, context);
+}
+
 int ClamirFunctions::ConnectDevice()
 {
-	connection_result = ConnectCLAMIR((char*)lIPAddress);
-	return connection_result;
+	int result = ClamirSession::Default().Connect();
+	if (result == 0)
+		RefreshParameters();
+	return result;
 }
 int ClamirFunctions::DisconnectDevice()
 {
-	connection_result = DisconnectCLAMIR();
-	return connection_result;
+	{
+		std::lock_guard<std::mutex> lock(parameter_lock);
+		parameter_cache_valid = false;
+	}
+	return ClamirSession::Default().Disconnect();
+}
+
+int ClamirFunctions::AutoCalibrateSet()
+{
+	ClamirSession::CommandLock command;
+	return CLAMIR_DEVICE_CALL(AutoCalibrateSet);
+}
+
+int ClamirFunctions::SaveEmbeddedConfigurationSet()
+{
+	ClamirSession::CommandLock command;
+	return CLAMIR_DEVICE_CALL(SaveEmbeddedConfigurationSet);
+}
+
+int ClamirFunctions::RefreshParameters()
+{
+	ParameterSnapshot snapshot;
+	memset(&snapshot, 0, sizeof(snapshot));
+	// The round trips are made without the cache lock so that cached reads are served meanwhile, and under the command channel so that no write lands between them
+	ClamirSession::CommandLock command;
+	int result = ReadParameters(&snapshot);
+	std::lock_guard<std::mutex> lock(parameter_lock);
+	parameter_cache_valid = result == 0;
+	if (parameter_cache_valid)
+		parameter_cache = snapshot;
+	return result;
+}
+
+int ClamirFunctions::GetParameters(ParameterSnapshot* snapshot)
+{
+	std::lock_guard<std::mutex> lock(parameter_lock);
+	if (!parameter_cache_valid)
+		return -4;
+	*snapshot = parameter_cache;
+	return 0;
+}
+
+#define CLAMIR_CACHED_PARAMETER_DEFINITION(name, type, ...) \
+int ClamirFunctions::name##Get(type* data) \
+{ \
+	{ \
+		std::lock_guard<std::mutex> lock(parameter_lock); \
+		if (parameter_cache_valid) \
+		{ \
+			*data = parameter_cache.name; \
+			return 0; \
+		} \
+	} \
+	ClamirSession::CommandLock command; \
+	return CLAMIR_DEVICE_CALL(name##Get, data); \
+} \
+int ClamirFunctions::name##Set(type data) \
+{ \
+	ClamirSession::CommandLock command; \
+	int result = ValidateParameter(PARAMETER_##name, data); \
+	if (result == 0) \
+		result = CLAMIR_DEVICE_CALL(name##Set, data); \
+	if (result == 0) \
+	{ \
+		std::lock_guard<std::mutex> lock(parameter_lock); \
+		parameter_cache.name = data; \
+	} \
+	return result; \
+}
+CLAMIR_SCALAR_PARAMETERS(CLAMIR_CACHED_PARAMETER_DEFINITION)
+#undef CLAMIR_CACHED_PARAMETER_DEFINITION
+
+int ClamirFunctions::ROICoordinatesGet(int16_t* X1, int16_t* Y1, int16_t* X2, int16_t* Y2)
+{
+	{
+		std::lock_guard<std::mutex> lock(parameter_lock);
+		if (parameter_cache_valid)
+		{
+			*X1 = parameter_cache.ROIX1;
+			*Y1 = parameter_cache.ROIY1;
+			*X2 = parameter_cache.ROIX2;
+			*Y2 = parameter_cache.ROIY2;
+			return 0;
+		}
+	}
+	ClamirSession::CommandLock command;
+	return CLAMIR_DEVICE_CALL(ROICoordinatesGet, X1, Y1, X2, Y2);
+}
+
+int ClamirFunctions::ROICoordinatesSet(int16_t X1, int16_t Y1, int16_t X2, int16_t Y2)
+{
+	if (!ParameterInBounds(CLAMIR_FIELD_ROIX1, X1) || !ParameterInBounds(CLAMIR_FIELD_ROIX1 + 1, Y1) ||
+		!ParameterInBounds(CLAMIR_FIELD_ROIX1 + 2, X2) || !ParameterInBounds(CLAMIR_FIELD_ROIX1 + 3, Y2))
+		return -3;
+	ParameterSnapshot proposed = {};
+	proposed.ROIX1 = X1;
+	proposed.ROIY1 = Y1;
+	proposed.ROIX2 = X2;
+	proposed.ROIY2 = Y2;
+	int violation = ParameterInternalViolation(proposed, PARAMETER_ROICoordinates);
+	if (violation != 0)
+		return violation;
+	ClamirSession::CommandLock command;
+	int result = CLAMIR_DEVICE_CALL(ROICoordinatesSet, X1, Y1, X2, Y2);
+	if (result == 0)
+	{
+		std::lock_guard<std::mutex> lock(parameter_lock);
+		parameter_cache.ROIX1 = X1;
+		parameter_cache.ROIY1 = Y1;
+		parameter_cache.ROIX2 = X2;
+		parameter_cache.ROIY2 = Y2;
+	}
+	return result;
+}
+
+int ClamirFunctions::AutoShutterConfigurationGet(int* flagEnable, int* flagEnableInProcess, int* flagTemperatureDrift, int* flagTimer)
+{
+	{
+		std::lock_guard<std::mutex> lock(parameter_lock);
+		if (parameter_cache_valid)
+		{
+			*flagEnable = parameter_cache.AutoShutterFlagEnable;
+			*flagEnableInProcess = parameter_cache.AutoShutterFlagEnableInProcess;
+			*flagTemperatureDrift = parameter_cache.AutoShutterFlagTemperatureDrift;
+			*flagTimer = parameter_cache.AutoShutterFlagTimer;
+			return 0;
+		}
+	}
+	ClamirSession::CommandLock command;
+	return CLAMIR_DEVICE_CALL(AutoShutterConfigurationGet, flagEnable, flagEnableInProcess, flagTemperatureDrift, flagTimer);
+}
+
+int ClamirFunctions::AutoShutterConfigurationSet(int flagEnable, int flagEnableInProcess, int flagTemperatureDrift, int flagTimer)
+{
+	const int flags[4] = { flagEnable, flagEnableInProcess, flagTemperatureDrift, flagTimer };
+	for (int i = 0; i < 4; i++)
+		if (!ParameterInBounds(CLAMIR_FIELD_AUTO_SHUTTER + i, flags[i]))
+			return -3;
+	ParameterSnapshot proposed = {};
+	proposed.AutoShutterFlagEnable = flagEnable;
+	proposed.AutoShutterFlagEnableInProcess = flagEnableInProcess;
+	proposed.AutoShutterFlagTemperatureDrift = flagTemperatureDrift;
+	proposed.AutoShutterFlagTimer = flagTimer;
+	int violation = ParameterInternalViolation(proposed, PARAMETER_AutoShutterConfiguration);
+	if (violation != 0)
+		return violation;
+	ClamirSession::CommandLock command;
+	int result = CLAMIR_DEVICE_CALL(AutoShutterConfigurationSet, flagEnable, flagEnableInProcess, flagTemperatureDrift, flagTimer);
+	if (result == 0)
+	{
+		std::lock_guard<std::mutex> lock(parameter_lock);
+		parameter_cache.AutoShutterFlagEnable = flagEnable;
+		parameter_cache.AutoShutterFlagEnableInProcess = flagEnableInProcess;
+		parameter_cache.AutoShutterFlagTemperatureDrift = flagTemperatureDrift;
+		parameter_cache.AutoShutterFlagTimer = flagTimer;
+	}
+	return result;
+}
+
+int ClamirFunctions::SerialNumberGet(char* data)
+{
+	{
+		std::lock_guard<std::mutex> lock(parameter_lock);
+		if (parameter_cache_valid)
+		{
+			strcpy(data, parameter_cache.SerialNumber);
+			return 0;
+		}
+	}
+	// Terminated like the cached copy, whatever the device writes past its 7 characters
+	char serial[64] = { 0 };
+	ClamirSession::CommandLock command;
+	int result = CLAMIR_DEVICE_CALL(SerialNumberGet, serial);
+	if (result == 0)
+	{
+		memcpy(data, serial, CLAMIR_SERIAL_NUMBER_CHARACTERS);
+		data[CLAMIR_SERIAL_NUMBER_CHARACTERS] = 0;
+	}
+	return result;
+}
+
+int ClamirFunctions::GetFrames(int n, FrameBlock* block)
+{
+	// Callers read Count even on failure, so it must never describe the frames of a previous call
+	block->Count = 0;
+	if (n < 0)
+		return -5;
+	if (acquisition_running.load())
+		return -4;
+
+	block->Resize(n);
+	ClamirSession& session = ClamirSession::Default();
+	ImageHeader header;
+	for (int i = 0; i < n; i++)
+	{
+		FrameTrace::Begin(TRACE_ACQUISITION);
+		int result = session.ReadImage(&header, block->Image(i));
+		FrameTrace::End(TRACE_ACQUISITION, result == 0 ? header.FrameNum : -1);
+		if (result != 0)
+			return result;
+		block->SetHeader(i, header);
+		block->Count = i + 1;
+	}
+	return 0;
+}
+
+int ClamirFunctions::StartAcquisition(int capacity)
+{
+	std::lock_guard<std::mutex> lock(acquisition_control);
+	if (frame_ring.load())
+	{
+		if (acquisition_running.load())
+			return -1;
+		// The previous thread stopped by itself on a closed connection
+		ReleaseAcquisition();
+	}
+
+	SpscRing<FrameLease>* ring = nullptr;
+	FramePool* pool = nullptr;
+	try
+	{
+		ring = new SpscRing<FrameLease>(capacity > 0 ? (size_t)capacity : 1);
+		pool = new FramePool((int)ring->Capacity() * 2);
+	}
+	catch (const std::bad_alloc&)
+	{
+		delete ring;
+		return -2;
+	}
+
+	frames_acquired = 0;
+	frames_dropped = 0;
+	read_errors = 0;
+	last_error = 0;
+	ring_high_water = 0;
+
+	frame_pool = pool;
+	frame_ring = ring;
+	acquisition_running = true;
+	acquisition_thread = std::thread(AcquisitionLoop, ring, pool);
+	return 0;
+}
+
+int ClamirFunctions::StopAcquisition()
+{
+	std::lock_guard<std::mutex> lock(acquisition_control);
+	if (!frame_ring.load())
+		return -1;
+	ReleaseAcquisition();
+	return 0;
+}
+
+int ClamirFunctions::PopFrame(ImageHeader* aImageHeader, int16_t* aImage)
+{
+	RingReader reader;
+	SpscRing<FrameLease>* ring = reader.ring;
+	if (!ring)
+		return -2;
+
+	bool stopped = !acquisition_running.load(std::memory_order_acquire);
+	FrameLease* entry = ring->Front();
+	if (!entry)
+		return stopped ? -2 : -1;
+	*aImageHeader = *entry->Header();
+	memcpy(aImage, entry->Image(), CLAMIR_IMAGE_PIXELS * sizeof(int16_t));
+	entry->Reset();
+	ring->Pop();
+	return 0;
+}
+
+int ClamirFunctions::PopFrame(FrameLease* lease)
+{
+	RingReader reader;
+	SpscRing<FrameLease>* ring = reader.ring;
+	if (!ring)
+		return -2;
+
+	bool stopped = !acquisition_running.load(std::memory_order_acquire);
+	FrameLease* entry = ring->Front();
+	if (!entry)
+		return stopped ? -2 : -1;
+	*lease = std::move(*entry);
+	ring->Pop();
+	return 0;
+}
+
+int ClamirFunctions::GetAcquisitionCounters(AcquisitionCounters* counters)
+{
+	std::lock_guard<std::mutex> lock(acquisition_control);
+	SpscRing<FrameLease>* ring = frame_ring.load();
+	if (!ring)
+		return -2;
+
+	counters->FramesAcquired = frames_acquired.load(std::memory_order_relaxed);
+	counters->FramesDropped = frames_dropped.load(std::memory_order_relaxed);
+	counters->ReadErrors = read_errors.load(std::memory_order_relaxed);
+	counters->LastError = last_error.load(std::memory_order_relaxed);
+	counters->RingOccupancy = (uint32_t)ring->Size();
+	counters->RingHighWater = ring_high_water.load(std::memory_order_relaxed);
+	counters->RingCapacity = (uint32_t)ring->Capacity();
+	counters->Running = acquisition_running.load() ? 1 : 0;
+	return 0;
+}
+
+int ClamirFunctions::ValidateParameter(int field, double value)
+{
+	if (field < 0 || field >= CLAMIR_PARAMETER_FIELDS || !ParameterInBounds(field, value))
+		return -3;
+	std::lock_guard<std::mutex> lock(parameter_lock);
+	if (!parameter_cache_valid)
+		return 0;
+	ParameterSnapshot proposed = parameter_cache;
+	SetParameterFieldValue(&proposed, field, value);
+	return ParameterConstraintViolation(proposed, field);
+}
+
+int ClamirFunctions::GetParameter(int field, double* value)
+{
+	if (field < 0 || field >= CLAMIR_PARAMETER_FIELDS)
+		return -3;
+
+	ParameterSnapshot snapshot;
+	int result;
+	switch (parameter_descriptors[field].Parameter)
+	{
+#define CLAMIR_GET_PARAMETER_CASE(name, type, ...) \
+	case PARAMETER_##name: \
+		result = name##Get(&snapshot.name); \
+		break;
+	CLAMIR_SCALAR_PARAMETERS(CLAMIR_GET_PARAMETER_CASE)
+#undef CLAMIR_GET_PARAMETER_CASE
+	case PARAMETER_ROICoordinates:
+		result = ROICoordinatesGet(&snapshot.ROIX1, &snapshot.ROIY1, &snapshot.ROIX2, &snapshot.ROIY2);
+		break;
+	default:
+		result = AutoShutterConfigurationGet(&snapshot.AutoShutterFlagEnable, &snapshot.AutoShutterFlagEnableInProcess,
+			&snapshot.AutoShutterFlagTemperatureDrift, &snapshot.AutoShutterFlagTimer);
+		break;
+	}
+	if (result == 0)
+		*value = ParameterFieldValue(snapshot, field);
+	return result;
+}
+
+int ClamirFunctions::SetParameter(int field, double value)
+{
+	if (field < 0 || field >= CLAMIR_PARAMETER_FIELDS)
+		return -3;
+
+	// The snapshot converts the value to the type of the field
+	ParameterSnapshot snapshot;
+	int result = 0;
+	switch (parameter_descriptors[field].Parameter)
+	{
+#define CLAMIR_SET_PARAMETER_CASE(name, type, ...) \
+	case PARAMETER_##name: \
+		SetParameterFieldValue(&snapshot, field, value); \
+		return name##Set(snapshot.name);
+	CLAMIR_SCALAR_PARAMETERS(CLAMIR_SET_PARAMETER_CASE)
+#undef CLAMIR_SET_PARAMETER_CASE
+	case PARAMETER_ROICoordinates:
+		result = ROICoordinatesGet(&snapshot.ROIX1, &snapshot.ROIY1, &snapshot.ROIX2, &snapshot.ROIY2);
+		if (result != 0)
+			return result;
+		SetParameterFieldValue(&snapshot, field, value);
+		return ROICoordinatesSet(snapshot.ROIX1, snapshot.ROIY1, snapshot.ROIX2, snapshot.ROIY2);
+	default:
+		result = AutoShutterConfigurationGet(&snapshot.AutoShutterFlagEnable, &snapshot.AutoShutterFlagEnableInProcess,
+			&snapshot.AutoShutterFlagTemperatureDrift, &snapshot.AutoShutterFlagTimer);
+		if (result != 0)
+			return result;
+		SetParameterFieldValue(&snapshot, field, value);
+		return AutoShutterConfigurationSet(snapshot.AutoShutterFlagEnable, snapshot.AutoShutterFlagEnableInProcess,
+			snapshot.AutoShutterFlagTemperatureDrift, snapshot.AutoShutterFlagTimer);
+	}
+}
+
+int ClamirFunctions::ApplyProfile(const ConfigurationProfile& profile, ProfileApplyResult* result)
+{
+	ProfileApplyResult outcome = { 0, 0, -1 };
+	if (result)
+		*result = outcome;
+
+	ParameterSnapshot current;
+	if (GetParameters(&current) != 0)
+	{
+		int refreshed = RefreshParameters();
+		if (refreshed != 0)
+			return refreshed;
+		GetParameters(&current);
+	}
+
+	int writes[PARAMETER_COUNT];
+	int count = profile.Plan(current, writes);
+	if (count < 0)
+		return count;
+	ParameterSnapshot target;
+	profile.Apply(current, &target);
+
+	outcome.Planned = count;
+	int code = 0;
+	for (int i = 0; i < count && code == 0; i++)
+	{
+		int parameter = writes[i];
+		if (parameter == PARAMETER_ROICoordinates)
+			code = ROICoordinatesSet(target.ROIX1, target.ROIY1, target.ROIX2, target.ROIY2);
+		else if (parameter == PARAMETER_AutoShutterConfiguration)
+			code = AutoShutterConfigurationSet(target.AutoShutterFlagEnable, target.AutoShutterFlagEnableInProcess,
+				target.AutoShutterFlagTemperatureDrift, target.AutoShutterFlagTimer);
+		else
+			code = SetParameter(parameter, ParameterFieldValue(target, parameter));
+		if (code == 0)
+			outcome.Written++;
+		else
+			outcome.FailedParameter = parameter;
+	}
+	if (result)
+		*result = outcome;
+	return code;
 }
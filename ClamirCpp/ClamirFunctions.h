@@ -2,13 +2,46 @@
 
 #include "CLAMIR_dll.h"
 #include "CImg.h"
+#include "ClamirParameters.h"
+#include "ClamirSession.h"
+#include "ParameterTable.h"
+#include "FramePool.h"
+#include "FrameBlock.h"
+#include "ClamirExport.h"
 
-#ifdef CLAMIRLIBRARY_EXPORTS
-#define CLAMIRLIBRARY_API __declspec(dllexport)
-#else
-#define CLAMIRLIBRARY_API __declspec(dllimport)
-#endif
+class ConfigurationProfile;
 
+/**
+* @struct ProfileApplyResult
+* @brief Outcome of ClamirFunctions::ApplyProfile
+* @param Planned Writes needed to reach the profile
+* @param Written Writes sent successfully, in plan order
+* @param FailedParameter ParameterId of the write that failed, -1 if none
+*/
+struct ProfileApplyResult
+{
+	int Planned, Written, FailedParameter;
+};
+
+/**
+* @struct AcquisitionCounters
+* @brief Snapshot of the background acquisition statistics
+* @param FramesAcquired Frames read from CLAMIR and published to the ring
+* @param FramesDropped Frames read from CLAMIR but discarded because the ring was full or every pool slot was leased (overruns)
+* @param ReadErrors GetImage calls that returned an error code
+* @param LastError Last error code returned by GetImage, 0 if none
+* @param RingOccupancy Frames waiting in the ring at the time of the snapshot
+* @param RingHighWater Highest occupancy observed since StartAcquisition
+* @param RingCapacity Number of slots of the ring
+* @param Running 1 while the acquisition thread runs, 0 once it stopped by itself on a closed connection
+*/
+struct AcquisitionCounters
+{
+	uint64_t FramesAcquired, FramesDropped, ReadErrors;
+	int LastError;
+	uint32_t RingOccupancy, RingHighWater, RingCapacity;
+	int Running;
+};
 
 class CLAMIRLIBRARY_API ClamirFunctions
 {
@@ -18,6 +51,188 @@ public:
 	static float Multiply(float a, float b);
 	static float Divide(float a, float b);
 
+	/**
+	@brief Sets the address used by ConnectDevice. The default is 192.168.1.77
+	@returns 0 on success
+	@returns -2 if the address is empty or does not fit CLAMIR_ADDRESS_SIZE
+	*/
+	static int SetDeviceAddress(const char* address);
+
+	/**
+	@brief Copies the address used by ConnectDevice
+	@param address Buffer of CLAMIR_ADDRESS_SIZE characters
+	*/
+	static void DeviceAddressGet(char* address);
+
+	/**
+	@brief Registers the function told about closed connections, or removes it when callback is null. Used by ConnectionManager
+	*While a callback is registered, a background acquisition survives a closed connection: the first failed read reports it, then the thread keeps reading and resumes publishing frames as soon as the connection is back.
+	*The callback is told once per lost connection, however many reads fail until the reconnection.
+	*Without a callback the acquisition thread stops on the first closed connection.
+	*/
+	static void SetConnectionLostCallback(ConnectionLostCallback callback, void* context);
+
+	/**
+	@brief Connects to CLAMIR and, on success, prefetches every parameter with RefreshParameters
+	@returns The result of ConnectCLAMIR; a failed prefetch leaves the parameter cache empty
+	*/
 	static int ConnectDevice();
 	static int DisconnectDevice();
+
+	/**
+	@brief The CLAMIR_dll.h commands of the same name, sent on the command channel of the default session
+	*/
+	static int AutoCalibrateSet();
+	static int SaveEmbeddedConfigurationSet();
+
+	/**
+	@brief Reads every parameter from the device into the parameter cache
+	*While the cache is filled, the Get functions below return the cached value without a round trip, and successful Set functions store the value they sent.
+	*The cache is emptied by DisconnectDevice. Parameters changed by other means, such as AutoCalibrateSet or another client, are only seen after a refresh.
+	@returns 0 on success
+	@returns The error code of the first failed Get otherwise, in which case the cache is left empty
+	*/
+	static int RefreshParameters();
+
+	/**
+	@brief Copies the parameter cache
+	@param snapshot Pointer where the function will store the cached parameters
+	@returns 0 on success
+	@returns -4 if the cache is empty
+	*/
+	static int GetParameters(ParameterSnapshot* snapshot);
+
+	/**
+	@brief Cached counterparts of the CLAMIR_dll.h Get and Set functions of the same name
+	*Get returns the cached value, or reads the device when the cache is empty. Set validates the value with ValidateParameter, writes the device and stores the value in the cache on success.
+	*Device round trips hold the command channel of ClamirSession::Default, so these functions can be called from any thread. A Set validates, writes and updates the cache as one step with respect to the other writers.
+	*Both return the codes of the CLAMIR_dll.h functions, and Set also the codes of ValidateParameter without any round trip.
+	*ROICoordinatesSet returns -3 out of bounds and -4 unless X1 < X2 and Y1 < Y2; AutoShutterConfigurationSet returns -3 unless exactly one of the temperature drift and timer flags is set.
+	*/
+#define CLAMIR_CACHED_PARAMETER_DECLARATION(name, type, ...) \
+	static int name##Get(type* data); \
+	static int name##Set(type data);
+	CLAMIR_SCALAR_PARAMETERS(CLAMIR_CACHED_PARAMETER_DECLARATION)
+#undef CLAMIR_CACHED_PARAMETER_DECLARATION
+	static int ROICoordinatesGet(int16_t* X1, int16_t* Y1, int16_t* X2, int16_t* Y2);
+	static int ROICoordinatesSet(int16_t X1, int16_t Y1, int16_t X2, int16_t Y2);
+	static int AutoShutterConfigurationGet(int* flagEnable, int* flagEnableInProcess, int* flagTemperatureDrift, int* flagTimer);
+	static int AutoShutterConfigurationSet(int flagEnable, int flagEnableInProcess, int flagTemperatureDrift, int flagTimer);
+	/**
+	@brief Null terminated serial number, cached or read from the device
+	@param data Room for CLAMIR_SERIAL_NUMBER_CHARACTERS + 1 characters
+	*/
+	static int SerialNumberGet(char* data);
+
+	/**
+	@brief Applies a configuration profile, sending only the parameters that differ from the parameter cache
+	*The cache is refreshed first if it is empty. Writes follow ConfigurationProfile::Plan and stop at the first failure.
+	@param result If not null, receives the number of planned and sent writes and the failed parameter
+	@returns 0 on success, including when nothing differs
+	@returns -3 or -4 if the profile is out of bounds, breaks the autoshutter flag rule or breaks a paired constraint, before anything is sent
+	@returns The error code of the failed refresh or write otherwise
+	*/
+	static int ApplyProfile(const ConfigurationProfile& profile, ProfileApplyResult* result = 0);
+
+	/**
+	@brief Checks a value before it is sent, against the bounds of parameter_descriptors and the constraints of parameter_constraints
+	*The other field of a constraint is taken from the parameter cache; when the cache is empty only the bounds are checked.
+	@param field Index in parameter_descriptors
+	@returns 0 if the value can be sent
+	@returns -3 on an out of bounds value, an unknown field, or autoshutter flags not selecting exactly one of temperature drift and timer
+	@returns -4 if the value would break a paired constraint, e.g. MaxPower not above the cached MinPower
+	*/
+	static int ValidateParameter(int field, double value);
+
+	/**
+	@brief Reads any field of parameter_descriptors, from the cache when it is filled
+	@returns The codes of the cached Get functions, or -3 for an unknown field
+	*/
+	static int GetParameter(int field, double* value);
+
+	/**
+	@brief Writes any field of parameter_descriptors through the cached Set functions. A ROI coordinate or autoshutter flag is written together with the cached values of the other ones
+	@returns The codes of the cached Set functions, or -3 for an unknown field
+	*/
+	static int SetParameter(int field, double value);
+
+	/**
+	@brief Typed access to a scalar parameter by ParameterId, e.g. Set<PARAMETER_KP>(300)
+	*/
+	template <int Id>
+	static int Get(typename ParameterTraits<Id>::Type* data)
+	{
+		double value;
+		int result = GetParameter(Id, &value);
+		if (result == 0)
+			*data = (typename ParameterTraits<Id>::Type)value;
+		return result;
+	}
+
+	template <int Id>
+	static int Set(typename ParameterTraits<Id>::Type data)
+	{
+		return SetParameter(Id, data);
+	}
+
+	/**
+	@brief Reads n consecutive images with GetImage into a structure-of-arrays block
+	*Images are written straight into the slices of the block volume. Must not be called while a background acquisition is running, since both would compete for the same image stream.
+	@param n Number of frames to read
+	@param block Block that will receive the frames. It is resized to n frames; block->Count holds the number of frames actually read, 0 when nothing was read
+	@returns 0 if all n frames were retrieved
+	@returns -1 on a timeout error
+	@returns -2 on another communication error
+	@returns -3 on a closed connection
+	@returns -4 if a background acquisition is running
+	@returns -5 if n is negative
+	*/
+	static int GetFrames(int n, FrameBlock* block);
+
+	/**
+	@brief Starts a dedicated thread that reads images with GetImage and queues them in a lock-free ring
+	*Images are read directly into slots of a FramePool sized to twice the ring capacity, so consumers can keep up to one ring's worth of leases while the ring is full.
+	*Without a connection lost callback the thread stops by itself on a closed connection. Frames already queued can still be popped, and the next StartAcquisition frees the stopped acquisition.
+	@param capacity Number of frames the ring can hold, rounded up to a power of two
+	@returns 0 if the acquisition thread was started
+	@returns -1 if an acquisition is already running
+	@returns -2 if the ring could not be allocated
+	*/
+	static int StartAcquisition(int capacity);
+
+	/**
+	@brief Stops the acquisition thread and frees the ring. Frames still queued are discarded
+	*Leases taken with PopFrame stay valid after the stop; the pool slots are freed when the last of them is released.
+	*Safe to call while the consumer is inside PopFrame: the ring is freed once the call has returned.
+	@returns 0 if the acquisition was stopped, or had stopped by itself
+	@returns -1 if no acquisition was running
+	*/
+	static int StopAcquisition();
+
+	/**
+	@brief Copies the oldest queued frame out of the acquisition ring. Must be called from a single consumer thread
+	@param aImageHeader Pointer to an ImageHeader structure
+	@param aImage Pointer to an array of 4096 int16_t pixels
+	@returns 0 if a frame was retrieved
+	@returns -1 if the ring is empty
+	@returns -2 if no acquisition is running, or the thread stopped by itself and the ring is drained
+	*/
+	static int PopFrame(ImageHeader* aImageHeader, int16_t* aImage);
+
+	/**
+	@brief Takes the oldest queued frame out of the acquisition ring without copying it. Must be called from a single consumer thread
+	@param lease Lease that will reference the frame slot. Release it as soon as the frame is no longer needed
+	@returns 0 if a frame was retrieved
+	@returns -1 if the ring is empty
+	@returns -2 if no acquisition is running, or the thread stopped by itself and the ring is drained
+	*/
+	static int PopFrame(FrameLease* lease);
+
+	/**
+	@brief Reads the acquisition counters
+	@param counters Pointer where the function will store the counters. They are kept after the thread stopped by itself, until StopAcquisition
+	@returns 0 on success
+	@returns -2 if no acquisition was started
+	*/
+	static int GetAcquisitionCounters(AcquisitionCounters* counters);
 };
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "CLAMIR_dll.h"
+
+/**
+*Every device parameter with a Get and a Set function of a single value, as X(Name, Type, Min, Max, Default) where Name##Get and Name##Set are the CLAMIR_dll.h functions and the bounds and default are the documented ones.
+*Expand it to declare, read or compare all of them at once; parameters added here are picked up by ParameterSnapshot and the ClamirFunctions cache.
+*/
+#define CLAMIR_SCALAR_PARAMETERS(X) \
+	X(KI, int16_t, 0, 30000, 500) \
+	X(KP, int16_t, 0, 30000, 200) \
+	X(KD, int16_t, 0, 30000, 100) \
+	X(MaxPower, int16_t, 100, 30000, 1500) \
+	X(MinPower, int16_t, -30000, 9900, 500) \
+	X(Threshold, int16_t, 0, 5000, 1200) \
+	X(ThresholdToStartTracks, int16_t, 0, 2000, 40) \
+	X(ThresholdToEndTracks, int16_t, 0, 1000, 30) \
+	X(ManualPower, int16_t, 0, 30000, 1000) \
+	X(Mode, int16_t, 0, 2, 2) \
+	X(ReferenceTrackStart, int16_t, 0, 100, 0) \
+	X(ReferenceTrackEnd, int16_t, 0, 100, 3) \
+	X(TrackDuration, float, 0.1, 1000.0, 2.0) \
+	X(ManualReferenceWidthValue, float, 0.0, 65.0, 1.0) \
+	X(RoundROI, int16_t, 0, 3, 0) \
+	X(EnableROI, int, 0, 1, 0) \
+	X(PowerLimitMax, int16_t, 1, 30000, 1500) \
+	X(PowerLimitMin, int16_t, 0, 9999, 500) \
+	X(PixelToMillimeterRatio, float, 0.01, 10.0, 0.015) \
+	X(EndOfProcessTime, int16_t, 500, 30000, 5000) \
+	X(LimitIntegral, int16_t, 0, 10000, 5000) \
+	X(LimitSlewRate, float, 0.01, 300.0, 1.0) \
+	X(CircularBufferSize, int16_t, 1, 512, 4) \
+	X(EnableAlarm, int, 0, 1, 0) \
+	X(AlarmMax, float, 0.0, 320.0, 5.0) \
+	X(AlarmMin, float, 0.0, 320.0, 1.0) \
+	X(AlarmTime, int16_t, 0, 10000, 2000) \
+	X(Automeasure, int, 0, 1, 1) \
+	X(AutoshutterDriftTemperature, float, 0.1, 50.0, 3.0) \
+	X(AutoshutterTimer, float, 10.0, 320000.0, 180.0) \
+	X(LaserExternal, int, 0, 1, 0) \
+	X(LaserONDelay, int16_t, 0, 1000, 0) \
+	X(EnablePreheating, int, 0, 1, 0) \
+	X(PreheatingTime, int16_t, 0, 30000, 0) \
+	X(PreheatingPower, int16_t, 0, 10000, 1500) \
+	X(IntegrationTime, int16_t, 50, 800, 200) \
+	X(BiasVoltage, float, 1.0, 3.0, 2.0) \
+	X(BlackLevel, int16_t, 0, 10000, 1000)
+
+// Characters written by SerialNumberGet, and the null terminated buffer that holds them
+#define CLAMIR_SERIAL_NUMBER_CHARACTERS 7
+#define CLAMIR_SERIAL_NUMBER_SIZE 16
+
+/**
+* @struct ParameterSnapshot
+* @brief Values of all the readable device parameters
+* @param ROIX1 ROIY1 ROIX2 ROIY2 Values of ROICoordinatesGet
+* @param AutoShutterFlagEnable AutoShutterFlagEnableInProcess AutoShutterFlagTemperatureDrift AutoShutterFlagTimer Values of AutoShutterConfigurationGet
+* @param SerialNumber Value of SerialNumberGet, null terminated
+* @param EmbeddedSWVersion Value of EmbeddedSWVersion
+*/
+struct ParameterSnapshot
+{
+#define CLAMIR_SNAPSHOT_FIELD(name, type, ...) type name;
+	CLAMIR_SCALAR_PARAMETERS(CLAMIR_SNAPSHOT_FIELD)
+#undef CLAMIR_SNAPSHOT_FIELD
+	int16_t ROIX1, ROIY1, ROIX2, ROIY2;
+	int AutoShutterFlagEnable, AutoShutterFlagEnableInProcess, AutoShutterFlagTemperatureDrift, AutoShutterFlagTimer;
+	char SerialNumber[CLAMIR_SERIAL_NUMBER_SIZE];
+	int16_t EmbeddedSWVersion;
+};
+
+/**
+@brief Identifies a parameter, e.g. for queued writes. One value per CLAMIR_SCALAR_PARAMETERS entry, in order, then the multi-valued parameters
+*/
+enum ParameterId
+{
+#define CLAMIR_PARAMETER_ID(name, type, ...) PARAMETER_##name,
+	CLAMIR_SCALAR_PARAMETERS(CLAMIR_PARAMETER_ID)
+#undef CLAMIR_PARAMETER_ID
+	PARAMETER_ROICoordinates,
+	PARAMETER_AutoShutterConfiguration,
+	PARAMETER_COUNT
+};
@@ -0,0 +1,190 @@
+#include "pch.h"
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include "ClamirSession.h"
+#include "DeviceCallStats.h"
+
+struct ClamirSessionState
+{
+	// Command channel. CommandCount is only written by the holder, so it needs no read-modify-write
+	std::mutex Commands;
+	std::atomic<uint64_t> CommandCount;
+	std::atomic<uint64_t> Contended, WaitTime, MaxWait;
+
+	// Image channel, held around GetImage and by Connect and Disconnect so the sockets are never replaced under a reader.
+	// LossReported is guarded by it and makes a closed connection reach the callback once, not on every read that fails after it
+	std::mutex Images;
+	bool LossReported;
+
+	mutable std::mutex AddressLock;
+	char Address[CLAMIR_ADDRESS_SIZE];
+	std::atomic<int> ConnectionResult;
+
+	// Taken only on a closed connection and by SetConnectionLostCallback; Watched lets the image thread check for a callback without it
+	std::mutex CallbackLock;
+	ConnectionLostCallback Callback;
+	void* CallbackContext;
+	std::atomic<bool> Watched;
+};
+
+ClamirSession& ClamirSession::Default()
+{
+	static ClamirSession session;
+	return session;
+}
+
+ClamirSession::ClamirSession() : state(new ClamirSessionState())
+{
+	state->CommandCount = 0;
+	state->Contended = 0;
+	state->WaitTime = 0;
+	state->MaxWait = 0;
+	strcpy(state->Address, "192.168.1.77");
+	state->ConnectionResult = 1;
+	state->LossReported = false;
+	state->Callback = nullptr;
+	state->CallbackContext = nullptr;
+	state->Watched = false;
+}
+
+ClamirSession::~ClamirSession()
+{
+	delete state;
+}
+
+void ClamirSession::LockCommands()
+{
+	if (!state->Commands.try_lock())
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		state->Commands.lock();
+		uint64_t wait = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+		state->Contended.fetch_add(1, std::memory_order_relaxed);
+		state->WaitTime.fetch_add(wait, std::memory_order_relaxed);
+		if (wait > state->MaxWait.load(std::memory_order_relaxed))
+			state->MaxWait.store(wait, std::memory_order_relaxed);
+	}
+	state->CommandCount.store(state->CommandCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void ClamirSession::UnlockCommands()
+{
+	state->Commands.unlock();
+}
+
+ClamirSession::CommandLock::CommandLock(ClamirSession& session) : session(session)
+{
+	session.LockCommands();
+}
+
+ClamirSession::CommandLock::~CommandLock()
+{
+	session.UnlockCommands();
+}
+
+int ClamirSession::SetAddress(const char* address)
+{
+	if (!address || !address[0] || strlen(address) >= CLAMIR_ADDRESS_SIZE)
+		return -2;
+	std::lock_guard<std::mutex> lock(state->AddressLock);
+	strcpy(state->Address, address);
+	return 0;
+}
+
+void ClamirSession::AddressGet(char* address) const
+{
+	std::lock_guard<std::mutex> lock(state->AddressLock);
+	strcpy(address, state->Address);
+}
+
+int ClamirSession::Connect()
+{
+	char address[CLAMIR_ADDRESS_SIZE];
+	AddressGet(address);
+	std::lock_guard<std::mutex> images(state->Images);
+	CommandLock lock(*this);
+	int result = CLAMIR_DEVICE_CALL(ConnectCLAMIR, address);
+	state->ConnectionResult = result;
+	if (result == 0)
+		state->LossReported = false;
+	return result;
+}
+
+int ClamirSession::Disconnect()
+{
+	std::lock_guard<std::mutex> images(state->Images);
+	CommandLock lock(*this);
+	int result = CLAMIR_DEVICE_CALL(DisconnectCLAMIR);
+	state->ConnectionResult = result;
+	// The reads that fail after a deliberate disconnect are not a loss
+	state->LossReported = true;
+	return result;
+}
+
+int ClamirSession::ConnectionResult() const
+{
+	return state->ConnectionResult;
+}
+
+int ClamirSession::IsConnected()
+{
+	CommandLock lock(*this);
+	return CLAMIR_DEVICE_CALL(IsConnected);
+}
+
+int ClamirSession::ReadImage(ImageHeader* aImageHeader, int16_t* aImage)
+{
+	std::lock_guard<std::mutex> images(state->Images);
+	int result = CLAMIR_DEVICE_CALL(GetImage, aImageHeader, aImage);
+	if (result == 0)
+		state->LossReported = false;
+	else if (result == -3 && !state->LossReported)
+	{
+		// Still under the image channel, so a reconnection cannot slip in before the report and be taken for lost
+		state->LossReported = true;
+		NotifyConnectionLost();
+	}
+	return result;
+}
+
+void ClamirSession::SetConnectionLostCallback(ConnectionLostCallback callback, void* context)
+{
+	std::lock_guard<std::mutex> lock(state->CallbackLock);
+	state->Callback = callback;
+	state->CallbackContext = context;
+	state->Watched = callback != nullptr;
+}
+
+bool ClamirSession::ConnectionWatched() const
+{
+	return state->Watched.load(std::memory_order_relaxed);
+}
+
+void ClamirSession::NotifyConnectionLost()
+{
+	std::lock_guard<std::mutex> lock(state->CallbackLock);
+	if (state->Callback)
+		state->Callback(state->CallbackContext);
+}
+
+SessionCounters ClamirSession::Counters() const
+{
+	SessionCounters counters;
+	counters.Commands = state->CommandCount.load(std::memory_order_relaxed);
+	counters.Contended = state->Contended.load(std::memory_order_relaxed);
+	counters.WaitTime = state->WaitTime.load(std::memory_order_relaxed);
+	counters.MaxWait = state->MaxWait.load(std::memory_order_relaxed);
+	counters.ConnectionResult = state->ConnectionResult;
+	return counters;
+}
+
+void ClamirSession::ResetCounters()
+{
+	std::lock_guard<std::mutex> lock(state->Commands);
+	state->CommandCount = 0;
+	state->Contended = 0;
+	state->WaitTime = 0;
+	state->MaxWait = 0;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <stdint.h>
+#include "CLAMIR_dll.h"
+#include "ClamirExport.h"
+
+/**
+*Size of the address buffer of ClamirSession::AddressGet, terminating null included
+*/
+#define CLAMIR_ADDRESS_SIZE 64
+
+/**
+@brief Called when GetImage reports a closed connection, once per connection, from the thread that read the image. Must return quickly and must not call Connect or Disconnect
+*/
+typedef void (*ConnectionLostCallback)(void* context);
+
+struct ClamirSessionState;
+
+/**
+* @struct SessionCounters
+* @brief Snapshot of the command channel contention statistics
+* @param Commands Times the command channel was taken, one per Get or Set sent, one per parameter refresh
+* @param Contended Times a thread had to wait because another one held the channel
+* @param WaitTime Nanoseconds spent waiting, summed over the contended acquisitions
+* @param MaxWait Longest wait in nanoseconds
+* @param ConnectionResult Result of the last ConnectCLAMIR or DisconnectCLAMIR call, 1 before the first one
+*/
+struct SessionCounters
+{
+	uint64_t Commands, Contended, WaitTime, MaxWait;
+	int ConnectionResult;
+};
+
+/**
+@class ClamirSession
+@brief Connection to a CLAMIR system, shared by the acquisition, UI and command threads
+
+*CLAMIR has two sockets. Commands on the command socket are request and reply pairs that must not interleave, so every Get and Set is sent while holding the command channel; a thread only pays for the lock when another one holds it.
+*Images arrive on the image socket, which has a single reader. ReadImage never takes the command channel, so a slow command does not delay frames and the acquisition thread never blocks on the UI.
+*ReadImage holds the image channel instead, which only Connect and Disconnect contend for: they wait for a GetImage in flight to return, so the sockets are never closed under a reader.
+*CLAMIR_dll.h holds one connection per process, so there is one session: ClamirFunctions and ConnectionManager work on Default.
+*/
+class CLAMIRLIBRARY_API ClamirSession
+{
+public:
+	static ClamirSession& Default();
+
+	ClamirSession(const ClamirSession&) = delete;
+	ClamirSession& operator=(const ClamirSession&) = delete;
+
+	/**
+	@brief Sets the address used by Connect. The default is 192.168.1.77
+	@returns 0 on success
+	@returns -2 if the address is empty or does not fit CLAMIR_ADDRESS_SIZE
+	*/
+	int SetAddress(const char* address);
+
+	/**
+	@param address Buffer of CLAMIR_ADDRESS_SIZE characters
+	*/
+	void AddressGet(char* address) const;
+
+	/**
+	@brief Calls ConnectCLAMIR with the session address, holding the image and command channels
+	@returns The result of ConnectCLAMIR
+	*/
+	int Connect();
+
+	/**
+	@brief Calls DisconnectCLAMIR, holding the image and command channels. Waits for a GetImage in flight to return, at most its timeout
+	@returns The result of DisconnectCLAMIR
+	*/
+	int Disconnect();
+
+	/**
+	@brief Result of the last Connect or Disconnect, 1 before the first one
+	*/
+	int ConnectionResult() const;
+
+	/**
+	@brief Calls IsConnected, holding the command channel
+	*/
+	int IsConnected();
+
+	/**
+	@brief Reads the next image with GetImage, holding the image channel. Meant for a single reader thread at a time
+	*The first closed connection after a successful read or Connect is reported to the connection lost callback before returning; the reads that keep failing on the same connection are not.
+	@returns The result of GetImage
+	*/
+	int ReadImage(ImageHeader* aImageHeader, int16_t* aImage);
+
+	/**
+	@brief Registers the function told about closed connections, or removes it when callback is null
+	*/
+	void SetConnectionLostCallback(ConnectionLostCallback callback, void* context);
+
+	/**
+	@brief true while a connection lost callback is registered. Lock-free
+	*/
+	bool ConnectionWatched() const;
+
+	SessionCounters Counters() const;
+	void ResetCounters();
+
+	/**
+	@class CommandLock
+	@brief Holds the command channel of a session for the lifetime of the object, e.g. around a raw CLAMIR_dll.h Get or Set
+	*/
+	class CLAMIRLIBRARY_API CommandLock
+	{
+	public:
+		explicit CommandLock(ClamirSession& session = Default());
+		~CommandLock();
+
+		CommandLock(const CommandLock&) = delete;
+		CommandLock& operator=(const CommandLock&) = delete;
+
+	private:
+		ClamirSession& session;
+	};
+
+private:
+	ClamirSession();
+	~ClamirSession();
+
+	void LockCommands();
+	void UnlockCommands();
+	void NotifyConnectionLost();
+
+	ClamirSessionState* state;
+};
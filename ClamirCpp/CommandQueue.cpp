@@ -0,0 +1,147 @@
+#include "pch.h"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "CommandQueue.h"
+#include "ClamirFunctions.h"
+
+namespace
+{
+	struct QueuedCommand
+	{
+		int Parameter;
+		std::function<int()> Call;
+		std::promise<int> Result;
+		std::shared_future<int> Future;
+	};
+}
+
+struct CommandQueueState
+{
+	std::mutex Lock;
+	std::condition_variable Wake, Idle;
+	std::deque<std::unique_ptr<QueuedCommand>> Queue;
+	// Waiting write of each parameter, null when there is none
+	QueuedCommand* Pending[PARAMETER_COUNT];
+	bool Busy, Stopping;
+	uint64_t Submitted, Coalesced, Executed;
+	std::thread Executor;
+};
+
+CommandQueue::CommandQueue() : state(new CommandQueueState())
+{
+	for (int i = 0; i < PARAMETER_COUNT; i++)
+		state->Pending[i] = 0;
+	state->Busy = state->Stopping = false;
+	state->Submitted = state->Coalesced = state->Executed = 0;
+	state->Executor = std::thread(&CommandQueue::Run, this);
+}
+
+CommandQueue::~CommandQueue()
+{
+	{
+		std::lock_guard<std::mutex> lock(state->Lock);
+		state->Stopping = true;
+	}
+	state->Wake.notify_one();
+	state->Executor.join();
+	delete state;
+}
+
+#define CLAMIR_QUEUED_PARAMETER_DEFINITION(name, type, ...) \
+std::shared_future<int> CommandQueue::name##Set(type data) \
+{ \
+	return Submit(PARAMETER_##name, [data]() { return ClamirFunctions::name##Set(data); }); \
+}
+CLAMIR_SCALAR_PARAMETERS(CLAMIR_QUEUED_PARAMETER_DEFINITION)
+#undef CLAMIR_QUEUED_PARAMETER_DEFINITION
+
+std::shared_future<int> CommandQueue::ROICoordinatesSet(int16_t X1, int16_t Y1, int16_t X2, int16_t Y2)
+{
+	return Submit(PARAMETER_ROICoordinates, [=]() { return ClamirFunctions::ROICoordinatesSet(X1, Y1, X2, Y2); });
+}
+
+std::shared_future<int> CommandQueue::AutoShutterConfigurationSet(int flagEnable, int flagEnableInProcess, int flagTemperatureDrift, int flagTimer)
+{
+	return Submit(PARAMETER_AutoShutterConfiguration, [=]() { return ClamirFunctions::AutoShutterConfigurationSet(flagEnable, flagEnableInProcess, flagTemperatureDrift, flagTimer); });
+}
+
+std::shared_future<int> CommandQueue::Write(int parameter, std::function<int()> write)
+{
+	return Submit(parameter >= 0 && parameter < PARAMETER_COUNT ? parameter : -1, std::move(write));
+}
+
+std::shared_future<int> CommandQueue::Execute(std::function<int()> command)
+{
+	return Submit(-1, std::move(command));
+}
+
+std::shared_future<int> CommandQueue::Submit(int parameter, std::function<int()> command)
+{
+	std::unique_lock<std::mutex> lock(state->Lock);
+	state->Submitted++;
+	if (parameter >= 0 && state->Pending[parameter])
+	{
+		QueuedCommand* pending = state->Pending[parameter];
+		pending->Call = std::move(command);
+		state->Coalesced++;
+		return pending->Future;
+	}
+
+	std::unique_ptr<QueuedCommand> queued(new QueuedCommand());
+	queued->Parameter = parameter;
+	queued->Call = std::move(command);
+	queued->Future = queued->Result.get_future().share();
+	std::shared_future<int> future = queued->Future;
+	if (parameter >= 0)
+		state->Pending[parameter] = queued.get();
+	state->Queue.push_back(std::move(queued));
+	lock.unlock();
+	state->Wake.notify_one();
+	return future;
+}
+
+void CommandQueue::Wait()
+{
+	std::unique_lock<std::mutex> lock(state->Lock);
+	state->Idle.wait(lock, [this]() { return state->Queue.empty() && !state->Busy; });
+}
+
+CommandQueueCounters CommandQueue::Counters() const
+{
+	std::lock_guard<std::mutex> lock(state->Lock);
+	CommandQueueCounters counters;
+	counters.Submitted = state->Submitted;
+	counters.Coalesced = state->Coalesced;
+	counters.Executed = state->Executed;
+	counters.Pending = (uint32_t)state->Queue.size();
+	return counters;
+}
+
+void CommandQueue::Run()
+{
+	std::unique_lock<std::mutex> lock(state->Lock);
+	for (;;)
+	{
+		state->Wake.wait(lock, [this]() { return state->Stopping || !state->Queue.empty(); });
+		if (state->Queue.empty())
+			break;
+
+		std::unique_ptr<QueuedCommand> command = std::move(state->Queue.front());
+		state->Queue.pop_front();
+		if (command->Parameter >= 0)
+			state->Pending[command->Parameter] = 0;
+		state->Busy = true;
+		lock.unlock();
+
+		command->Result.set_value(command->Call());
+
+		lock.lock();
+		state->Busy = false;
+		state->Executed++;
+		if (state->Queue.empty())
+			state->Idle.notify_all();
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <functional>
+#include <future>
+#include "ClamirParameters.h"
+#include "ClamirExport.h"
+
+struct CommandQueueState;
+
+/**
+* @struct CommandQueueCounters
+* @brief Snapshot of the command queue statistics
+* @param Submitted Commands and writes queued since the queue was created
+* @param Coalesced Writes that replaced the value of a pending write to the same parameter instead of being queued
+* @param Executed Commands sent to the device
+* @param Pending Commands waiting to be sent
+*/
+struct CommandQueueCounters
+{
+	uint64_t Submitted, Coalesced, Executed;
+	uint32_t Pending;
+};
+
+/**
+@class CommandQueue
+@brief Executor thread for device commands, so that callers never wait for a round trip
+
+*Parameter writes go through the cached ClamirFunctions Set functions on the executor thread. A write to a parameter that already has a write waiting is coalesced: the waiting write takes the new value and keeps its place in the queue, and both callers receive its future, which holds the result code of the value actually sent.
+*Commands are sent in the order their first write was queued. A write that is already being sent is not touched; a new write to the same parameter is queued behind it.
+*Only the queue lock is taken by the submitting thread, for the time of a few pointer updates.
+*/
+class CLAMIRLIBRARY_API CommandQueue
+{
+public:
+	CommandQueue();
+
+	/**
+	@brief Sends the commands still queued, then stops the executor thread
+	*/
+	~CommandQueue();
+
+	CommandQueue(const CommandQueue&) = delete;
+	CommandQueue& operator=(const CommandQueue&) = delete;
+
+	/**
+	@brief Queued counterparts of the ClamirFunctions Set functions. The future holds the result code of the write
+	*/
+#define CLAMIR_QUEUED_PARAMETER_DECLARATION(name, type, ...) \
+	std::shared_future<int> name##Set(type data);
+	CLAMIR_SCALAR_PARAMETERS(CLAMIR_QUEUED_PARAMETER_DECLARATION)
+#undef CLAMIR_QUEUED_PARAMETER_DECLARATION
+	std::shared_future<int> ROICoordinatesSet(int16_t X1, int16_t Y1, int16_t X2, int16_t Y2);
+	std::shared_future<int> AutoShutterConfigurationSet(int flagEnable, int flagEnableInProcess, int flagTemperatureDrift, int flagTimer);
+
+	/**
+	@brief Queues a write that is coalesced with the pending writes of the same parameter
+	@param parameter One of the ParameterId values
+	@param write Function making the write and returning its result code
+	*/
+	std::shared_future<int> Write(int parameter, std::function<int()> write);
+
+	/**
+	@brief Queues a command that is never coalesced, e.g. AutoCalibrateSet or SaveEmbeddedConfigurationSet
+	*/
+	std::shared_future<int> Execute(std::function<int()> command);
+
+	/**
+	@brief Blocks until every queued command has been sent. Not meant for the UI or acquisition threads
+	*/
+	void Wait();
+
+	CommandQueueCounters Counters() const;
+
+private:
+	std::shared_future<int> Submit(int parameter, std::function<int()> command);
+	void Run();
+
+	CommandQueueState* state;
+};
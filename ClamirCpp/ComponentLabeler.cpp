@@ -0,0 +1,148 @@
+#include "pch.h"
+#include <string.h>
+#include "ComponentLabeler.h"
+#include "BitOps.h"
+
+ComponentLabeler::ComponentLabeler() : runCount(0), componentCount(0)
+{
+}
+
+int ComponentLabeler::Find(int run)
+{
+	int root = run;
+	while (parent[root] != root)
+		root = parent[root];
+	while (parent[run] != root)
+	{
+		int next = parent[run];
+		parent[run] = (uint16_t)root;
+		run = next;
+	}
+	return root;
+}
+
+int ComponentLabeler::Label(const MeltPoolMask& mask, const int16_t* aImage, bool eightConnected)
+{
+	runCount = 0;
+	componentCount = 0;
+
+	// Runs are [X0, X1) so overlap is X0 < other.X1. Diagonal neighbours also touch when X0 == other.X1
+	int reach = eightConnected ? 1 : 0;
+	int previousStart = 0, previousEnd = 0;
+	for (int y = 0; y < CLAMIR_IMAGE_HEIGHT; y++)
+	{
+		int rowStart = runCount;
+		uint64_t bits = mask.Rows[y];
+		while (bits)
+		{
+			int x0 = LowestBit(bits);
+			uint64_t clear = ~bits & (~0ull << x0);
+			int x1 = clear ? LowestBit(clear) : CLAMIR_IMAGE_WIDTH;
+			bits = x1 < CLAMIR_IMAGE_WIDTH ? bits & (~0ull << x1) : 0;
+
+			Run& run = runs[runCount];
+			run.Y = (uint8_t)y;
+			run.X0 = (uint8_t)x0;
+			run.X1 = (uint8_t)x1;
+			parent[runCount] = (uint16_t)runCount;
+			runCount++;
+		}
+
+		// Both rows are sorted by X0, so overlapping runs are found in one merge pass
+		int above = previousStart;
+		for (int r = rowStart; r < runCount; r++)
+		{
+			while (above < previousEnd && runs[above].X1 + reach <= runs[r].X0)
+				above++;
+			for (int a = above; a < previousEnd && runs[a].X0 < runs[r].X1 + reach; a++)
+			{
+				int rootA = Find(a), rootR = Find(r);
+				// The root is always the earliest run, so components keep the raster order of their first pixel
+				if (rootA < rootR)
+					parent[rootR] = (uint16_t)rootA;
+				else if (rootR < rootA)
+					parent[rootA] = (uint16_t)rootR;
+			}
+		}
+		previousStart = rowStart;
+		previousEnd = runCount;
+	}
+
+	// Parents always precede their runs, so one forward pass resolves every run to its root without Find
+	for (int r = 0; r < runCount; r++)
+	{
+		Run& run = runs[r];
+		int length = run.X1 - run.X0;
+		if (parent[r] == r)
+		{
+			MeltPoolComponent& component = components[componentCount];
+			component.Area = 0;
+			component.X0 = run.X0;
+			component.X1 = run.X1 - 1;
+			component.Y0 = component.Y1 = run.Y;
+			component.IntensitySum = 0;
+			sumX[componentCount] = sumY[componentCount] = 0;
+			run.Component = (uint16_t)componentCount++;
+		}
+		else
+			run.Component = runs[parent[r]].Component;
+
+		MeltPoolComponent& component = components[run.Component];
+		component.Area += length;
+		component.X0 = run.X0 < component.X0 ? run.X0 : component.X0;
+		component.X1 = run.X1 - 1 > component.X1 ? run.X1 - 1 : component.X1;
+		component.Y1 = run.Y;
+		// Twice the sum of the x coordinates, so it stays an integer
+		sumX[run.Component] += (run.X0 + run.X1 - 1) * length;
+		sumY[run.Component] += run.Y * length;
+		if (aImage)
+		{
+			const int16_t* pixel = aImage + run.Y * CLAMIR_IMAGE_WIDTH;
+			int sum = 0;
+			for (int x = run.X0; x < run.X1; x++)
+				sum += pixel[x];
+			component.IntensitySum += sum;
+		}
+	}
+
+	for (int i = 0; i < componentCount; i++)
+	{
+		components[i].CentroidX = 0.5f * sumX[i] / components[i].Area;
+		components[i].CentroidY = (float)sumY[i] / components[i].Area;
+	}
+	return componentCount;
+}
+
+int ComponentLabeler::Largest() const
+{
+	int largest = -1;
+	for (int i = 0; i < componentCount; i++)
+		if (largest < 0 || components[i].Area > components[largest].Area)
+			largest = i;
+	return largest;
+}
+
+void ComponentLabeler::ComponentMask(int i, MeltPoolMask* mask) const
+{
+	mask->Clear();
+	for (int r = 0; r < runCount; r++)
+	{
+		const Run& run = runs[r];
+		if (run.Component != i)
+			continue;
+		uint64_t bits = run.X1 - run.X0 == CLAMIR_IMAGE_WIDTH ? ~0ull : ((1ull << (run.X1 - run.X0)) - 1) << run.X0;
+		mask->Rows[run.Y] |= bits;
+	}
+}
+
+void ComponentLabeler::LabelImage(uint16_t* labels) const
+{
+	memset(labels, 0, CLAMIR_IMAGE_PIXELS * sizeof(uint16_t));
+	for (int r = 0; r < runCount; r++)
+	{
+		const Run& run = runs[r];
+		uint16_t* row = labels + run.Y * CLAMIR_IMAGE_WIDTH;
+		for (int x = run.X0; x < run.X1; x++)
+			row[x] = (uint16_t)(run.Component + 1);
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "ClamirFrame.h"
+#include "MeltPoolMask.h"
+#include "ClamirExport.h"
+
+// A 64 pixel row holds at most 32 runs, so a frame holds at most 2048 runs and as many components
+#define CLAMIR_MAX_RUNS (CLAMIR_IMAGE_HEIGHT * CLAMIR_IMAGE_WIDTH / 2)
+
+/**
+@brief Measurements of one connected component
+*/
+struct MeltPoolComponent
+{
+	int Area;
+	// Bounding box, both corners included
+	int X0, Y0, X1, Y1;
+	// Mean pixel position
+	float CentroidX, CentroidY;
+	// Sum of the pixel values of the component, 0 when no image is given
+	int64_t IntensitySum;
+};
+
+/**
+@class ComponentLabeler
+@brief Connected-component labeling of 64x64 melt pool masks
+
+*Rows are split into runs of set bits, runs overlapping on consecutive rows are merged with a union-find over runs, and the components are measured while the runs are resolved.
+*All the scratch space is a member of fixed size, so labeling never allocates. The object is about 110 KB: keep one per thread rather than one per call on the stack.
+*Components are numbered in raster order of their first pixel, as CImg<T>::label numbers them.
+*/
+class CLAMIRLIBRARY_API ComponentLabeler
+{
+public:
+	ComponentLabeler();
+
+	/**
+	@brief Labels a mask
+	@param mask Mask to label, e.g. built by MeltPoolMask::Build
+	@param aImage Pointer to the 4096 int16_t pixels the intensity sums are taken from, or a null pointer
+	@param eightConnected true to join diagonal neighbours, false for 4-connectivity as CImg<T>::label uses by default
+	@returns the number of components
+	*/
+	int Label(const MeltPoolMask& mask, const int16_t* aImage = 0, bool eightConnected = false);
+
+	int Count() const { return componentCount; }
+	const MeltPoolComponent& Component(int i) const { return components[i]; }
+
+	/**
+	@returns the index of the component with the largest area, the main melt pool, or -1 if there is none
+	*/
+	int Largest() const;
+
+	/**
+	@brief Writes the mask of component i
+	*/
+	void ComponentMask(int i, MeltPoolMask* mask) const;
+
+	/**
+	@brief Writes a label image: 0 for background, i + 1 for the pixels of component i
+	@param labels Pointer to an array of 4096 uint16_t
+	*/
+	void LabelImage(uint16_t* labels) const;
+
+private:
+	struct Run
+	{
+		uint8_t Y, X0, X1;
+		uint16_t Component;
+	};
+
+	int Find(int run);
+
+	Run runs[CLAMIR_MAX_RUNS];
+	uint16_t parent[CLAMIR_MAX_RUNS];
+	int runCount;
+	MeltPoolComponent components[CLAMIR_MAX_RUNS];
+	int sumX[CLAMIR_MAX_RUNS], sumY[CLAMIR_MAX_RUNS];
+	int componentCount;
+};
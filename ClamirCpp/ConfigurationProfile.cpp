@@ -0,0 +1,200 @@
+#include "pch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ConfigurationProfile.h"
+
+namespace
+{
+	char* Trim(char* text)
+	{
+		while (*text == ' ' || *text == '\t')
+			text++;
+		char* end = text + strlen(text);
+		while (end > text && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r' || end[-1] == '\n'))
+			end--;
+		*end = 0;
+		return text;
+	}
+
+	int FindField(const char* name)
+	{
+		for (int field = 0; field < CLAMIR_PARAMETER_FIELDS; field++)
+			if (strcmp(parameter_descriptors[field].Name, name) == 0)
+				return field;
+		return -1;
+	}
+
+	bool SameValue(const ParameterSnapshot& a, const ParameterSnapshot& b, int field)
+	{
+		return ParameterFieldValue(a, field) == ParameterFieldValue(b, field);
+	}
+}
+
+ConfigurationProfile::ConfigurationProfile()
+{
+	Clear();
+}
+
+void ConfigurationProfile::Clear()
+{
+	for (int field = 0; field < CLAMIR_PARAMETER_FIELDS; field++)
+	{
+		values[field] = 0.0;
+		has[field] = false;
+	}
+	errorLine = 0;
+}
+
+void ConfigurationProfile::Set(int field, double value)
+{
+	values[field] = value;
+	has[field] = true;
+}
+
+void ConfigurationProfile::Unset(int field)
+{
+	has[field] = false;
+}
+
+int ConfigurationProfile::Load(const char* path, const char* name)
+{
+	FILE* file = fopen(path, "r");
+	if (!file)
+		return -1;
+
+	Clear();
+	char line[CLAMIR_PROFILE_MAX_LINE];
+	int lineNumber = 0;
+	bool inSection = name == 0, found = name == 0;
+	int result = 0;
+	while (fgets(line, sizeof(line), file))
+	{
+		lineNumber++;
+		char* text = Trim(line);
+		if (*text == 0 || *text == '#' || *text == ';')
+			continue;
+		if (*text == '[')
+		{
+			char* close = strchr(text, ']');
+			if (close)
+				*close = 0;
+			inSection = name != 0 && strcmp(Trim(text + 1), name) == 0;
+			found = found || inSection;
+			continue;
+		}
+		if (!inSection)
+			continue;
+
+		char* separator = strchr(text, '=');
+		int field = -1;
+		char* end = 0;
+		double value = 0.0;
+		if (separator)
+		{
+			*separator = 0;
+			field = FindField(Trim(text));
+			char* number = Trim(separator + 1);
+			value = strtod(number, &end);
+			if (end == number || *end != 0)
+				field = -1;
+		}
+		if (field < 0)
+		{
+			errorLine = lineNumber;
+			result = -2;
+			break;
+		}
+		Set(field, value);
+	}
+	fclose(file);
+	if (result == 0 && !found)
+		result = -3;
+	return result;
+}
+
+int ConfigurationProfile::Save(const char* path, const char* name) const
+{
+	FILE* file = fopen(path, "w");
+	if (!file)
+		return -1;
+
+	bool failed = name && fprintf(file, "[%s]\n", name) < 0;
+	for (int field = 0; field < CLAMIR_PARAMETER_FIELDS && !failed; field++)
+	{
+		if (!has[field])
+			continue;
+		const ParameterDescriptor& descriptor = parameter_descriptors[field];
+		if (descriptor.Type == PARAMETER_TYPE_FLOAT)
+			failed = fprintf(file, "%s = %.9g\n", descriptor.Name, values[field]) < 0;
+		else
+			failed = fprintf(file, "%s = %.0f\n", descriptor.Name, values[field]) < 0;
+	}
+	if (fclose(file) != 0)
+		failed = true;
+	return failed ? -1 : 0;
+}
+
+void ConfigurationProfile::Capture(const ParameterSnapshot& snapshot)
+{
+	for (int field = 0; field < CLAMIR_PARAMETER_FIELDS; field++)
+		Set(field, ParameterFieldValue(snapshot, field));
+}
+
+void ConfigurationProfile::Apply(const ParameterSnapshot& current, ParameterSnapshot* target) const
+{
+	*target = current;
+	for (int field = 0; field < CLAMIR_PARAMETER_FIELDS; field++)
+		if (has[field])
+			SetParameterFieldValue(target, field, values[field]);
+}
+
+int ConfigurationProfile::Plan(const ParameterSnapshot& current, int* writes) const
+{
+	for (int field = 0; field < CLAMIR_PARAMETER_FIELDS; field++)
+		if (has[field] && !ParameterInBounds(field, values[field]))
+			return -3;
+	ParameterSnapshot target;
+	Apply(current, &target);
+	// Checked on the whole target, so the autoshutter flags are refused before the profile writes anything
+	int violation = ParameterConstraintViolation(target);
+	if (violation != 0)
+		return violation;
+
+	// A multi-valued parameter is written once when any of its fields changes
+	bool changed[PARAMETER_COUNT] = {};
+	for (int field = 0; field < CLAMIR_PARAMETER_FIELDS; field++)
+		if (!SameValue(current, target, field))
+			changed[parameter_descriptors[field].Parameter] = true;
+
+	bool written[PARAMETER_COUNT] = {};
+	int count = 0;
+	for (int parameter = 0; parameter < PARAMETER_COUNT; parameter++)
+	{
+		if (!changed[parameter] || written[parameter])
+			continue;
+
+		// Pairs where both sides change: lower first when the new lower is below the current upper, upper first otherwise
+		for (int i = 0; i < CLAMIR_PARAMETER_CONSTRAINTS; i++)
+		{
+			const ParameterConstraint& constraint = parameter_constraints[i];
+			int lower = parameter_descriptors[constraint.First].Parameter, upper = parameter_descriptors[constraint.Second].Parameter;
+			if (constraint.Relation == PARAMETER_EXACTLY_ONE || lower == upper || (lower != parameter && upper != parameter))
+				continue;
+			int other = lower == parameter ? upper : lower;
+			if (!changed[other] || written[other])
+				continue;
+			double newLower = ParameterFieldValue(target, constraint.First), currentUpper = ParameterFieldValue(current, constraint.Second);
+			bool lowerFirst = constraint.Relation == PARAMETER_BELOW ? newLower < currentUpper : newLower <= currentUpper;
+			writes[count++] = lowerFirst ? lower : upper;
+			writes[count++] = lowerFirst ? upper : lower;
+			written[lower] = written[upper] = true;
+		}
+		if (!written[parameter])
+		{
+			writes[count++] = parameter;
+			written[parameter] = true;
+		}
+	}
+	return count;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "ParameterTable.h"
+#include "ClamirExport.h"
+
+/**
+*Profile files are text, one "Name = value" line per field with the names of parameter_descriptors. Lines starting with # or ; are comments.
+*A file can hold several profiles, each starting with a "[profile name]" line. The lines before the first section form the unnamed profile.
+*/
+#define CLAMIR_PROFILE_MAX_LINE 256
+
+/**
+@class ConfigurationProfile
+@brief Set of parameter values to apply to a device, e.g. for a job changeover
+
+*A profile holds any subset of the fields of parameter_descriptors; the others are left as they are on the device.
+*Plan diffs the profile against a snapshot and orders the writes so that paired limits never pass through an invalid state: when both sides of a pair change, the side that keeps the pair valid with the current value of the other is written first.
+*ClamirFunctions::ApplyProfile sends the plan against the parameter cache.
+*/
+class CLAMIRLIBRARY_API ConfigurationProfile
+{
+public:
+	ConfigurationProfile();
+
+	void Clear();
+
+	/**
+	@brief Loads a profile from a file, replacing the current values
+	@param name Section of the profile, or null for the lines before the first section
+	@returns 0 on success
+	@returns -1 if the file cannot be opened
+	@returns -2 on a line that is not a known field and a number, see ErrorLine
+	@returns -3 if the file has no such section
+	*/
+	int Load(const char* path, const char* name = 0);
+
+	/**
+	@brief Writes the fields of the profile to a file, replacing it
+	@param name Section written before the fields, or null for none
+	@returns 0 on success
+	@returns -1 on a file error
+	*/
+	int Save(const char* path, const char* name = 0) const;
+
+	/**
+	@brief Sets every field from a snapshot, e.g. to save the current device configuration
+	*/
+	void Capture(const ParameterSnapshot& snapshot);
+
+	void Set(int field, double value);
+	void Unset(int field);
+	bool Has(int field) const { return has[field]; }
+	double Value(int field) const { return values[field]; }
+
+	/**
+	@brief Line of the last Load error, 0 if none
+	*/
+	int ErrorLine() const { return errorLine; }
+
+	/**
+	@brief Returns current with the values of the profile applied, converted to the types of the fields
+	*/
+	void Apply(const ParameterSnapshot& current, ParameterSnapshot* target) const;
+
+	/**
+	@brief Lists the writes needed to go from current to the profile, in the order they must be sent
+	@param writes Receives ParameterId values, one per changed parameter; room for PARAMETER_COUNT
+	@returns The number of writes
+	@returns -3 if a value of the profile is out of bounds, or the resulting autoshutter flags do not select exactly one of temperature drift and timer
+	@returns -4 if the resulting configuration breaks a paired constraint
+	*/
+	int Plan(const ParameterSnapshot& current, int* writes) const;
+
+private:
+	double values[CLAMIR_PARAMETER_FIELDS];
+	bool has[CLAMIR_PARAMETER_FIELDS];
+	int errorLine;
+};
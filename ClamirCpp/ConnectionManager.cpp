@@ -0,0 +1,240 @@
+#include "pch.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "ConnectionManager.h"
+#include "ClamirFunctions.h"
+
+namespace
+{
+	// Manager owning the connection of ClamirFunctions, null when none is running
+	std::atomic<ConnectionManager*> active_manager(nullptr);
+
+	void OnConnectionLost(void* context)
+	{
+		static_cast<ConnectionManager*>(context)->ReportConnectionLost();
+	}
+
+	int BackoffDelay(const ConnectionSettings& settings, int failures)
+	{
+		// 64 bit so the doubling cannot overflow before it reaches MaxBackoff
+		int64_t delay = settings.InitialBackoff;
+		for (int i = 1; i < failures && delay < settings.MaxBackoff; i++)
+			delay *= 2;
+		return delay < settings.MaxBackoff ? (int)delay : settings.MaxBackoff;
+	}
+}
+
+struct ConnectionManagerState
+{
+	mutable std::mutex Lock;
+	std::condition_variable Wake, Connected;
+	ConnectionSettings Settings;
+	int State;
+	bool Running, Stopping, Lost;
+	uint64_t Attempts, Connects, LinkLosses, HealthChecks;
+	int LastError;
+	double LastOutage;
+	std::chrono::steady_clock::time_point LostSince;
+	std::thread Worker;
+};
+
+ConnectionManager::ConnectionManager() : state(new ConnectionManagerState())
+{
+	state->Settings = DefaultSettings();
+	state->State = CONNECTION_STOPPED;
+	state->Running = state->Stopping = state->Lost = false;
+	state->Attempts = state->Connects = state->LinkLosses = state->HealthChecks = 0;
+	state->LastError = 0;
+	state->LastOutage = 0.0;
+}
+
+ConnectionManager::~ConnectionManager()
+{
+	Stop();
+	delete state;
+}
+
+ConnectionSettings ConnectionManager::DefaultSettings()
+{
+	ConnectionSettings settings = { CLAMIR_CONNECT_INITIAL_BACKOFF, CLAMIR_CONNECT_MAX_BACKOFF, CLAMIR_HEALTH_INTERVAL, 0 };
+	return settings;
+}
+
+int ConnectionManager::Start(const ConnectionSettings* settings)
+{
+	ConnectionSettings policy = settings ? *settings : DefaultSettings();
+	if (policy.InitialBackoff < 1 || policy.MaxBackoff < policy.InitialBackoff || policy.HealthInterval < 1 || policy.MaxAttempts < 0)
+		return -3;
+
+	ConnectionManager* none = nullptr;
+	if (!active_manager.compare_exchange_strong(none, this))
+		return -1;
+
+	{
+		std::lock_guard<std::mutex> lock(state->Lock);
+		state->Settings = policy;
+		state->State = CONNECTION_CONNECTING;
+		state->Running = true;
+		state->Stopping = state->Lost = false;
+		state->Attempts = state->Connects = state->LinkLosses = state->HealthChecks = 0;
+		state->LastError = 0;
+		state->LastOutage = 0.0;
+	}
+	ClamirFunctions::SetConnectionLostCallback(OnConnectionLost, this);
+	state->Worker = std::thread(&ConnectionManager::Run, this);
+	return 0;
+}
+
+int ConnectionManager::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(state->Lock);
+		if (!state->Running)
+			return -1;
+		state->Stopping = true;
+	}
+	state->Wake.notify_one();
+	state->Worker.join();
+
+	// Not under the state lock: the callback takes it while ClamirFunctions holds its own
+	ClamirFunctions::SetConnectionLostCallback(nullptr, nullptr);
+	ClamirFunctions::DisconnectDevice();
+	{
+		std::lock_guard<std::mutex> lock(state->Lock);
+		state->State = CONNECTION_STOPPED;
+		state->Running = false;
+	}
+	state->Connected.notify_all();
+	active_manager = nullptr;
+	return 0;
+}
+
+int ConnectionManager::State() const
+{
+	std::lock_guard<std::mutex> lock(state->Lock);
+	return state->State;
+}
+
+int ConnectionManager::WaitConnected(int timeout)
+{
+	std::unique_lock<std::mutex> lock(state->Lock);
+	bool settled = state->Connected.wait_for(lock, std::chrono::milliseconds(timeout), [this]()
+	{
+		return state->State != CONNECTION_CONNECTING;
+	});
+	if (!settled)
+		return -1;
+	return state->State == CONNECTION_CONNECTED ? 0 : -2;
+}
+
+void ConnectionManager::ReportConnectionLost()
+{
+	{
+		std::lock_guard<std::mutex> lock(state->Lock);
+		if (state->State != CONNECTION_CONNECTED)
+			return;
+		state->Lost = true;
+	}
+	state->Wake.notify_one();
+}
+
+ConnectionCounters ConnectionManager::Counters() const
+{
+	std::lock_guard<std::mutex> lock(state->Lock);
+	ConnectionCounters counters;
+	counters.Attempts = state->Attempts;
+	counters.Connects = state->Connects;
+	counters.LinkLosses = state->LinkLosses;
+	counters.HealthChecks = state->HealthChecks;
+	counters.State = state->State;
+	counters.LastError = state->LastError;
+	counters.LastOutage = state->LastOutage;
+	return counters;
+}
+
+void ConnectionManager::Run()
+{
+	std::unique_lock<std::mutex> lock(state->Lock);
+	int failures = 0;
+	bool recovering = false;
+	while (!state->Stopping)
+	{
+		if (state->State == CONNECTION_CONNECTED)
+		{
+			state->Wake.wait_for(lock, std::chrono::milliseconds(state->Settings.HealthInterval), [this]()
+			{
+				return state->Stopping || state->Lost;
+			});
+			if (state->Stopping)
+				break;
+			if (!state->Lost)
+			{
+				lock.unlock();
+				bool healthy = ClamirSession::Default().IsConnected() == 1;
+				lock.lock();
+				state->HealthChecks++;
+				if (healthy && !state->Lost)
+					continue;
+			}
+
+			state->Lost = false;
+			state->LinkLosses++;
+			state->State = CONNECTION_CONNECTING;
+			state->LostSince = std::chrono::steady_clock::now();
+			recovering = true;
+			failures = 0;
+			// Frees the sockets once the acquisition thread is out of GetImage. The parameter cache is kept, so the reconnection below is a single round trip
+			lock.unlock();
+			ClamirSession::Default().Disconnect();
+			lock.lock();
+			continue;
+		}
+
+		if (failures > 0)
+		{
+			state->Wake.wait_for(lock, std::chrono::milliseconds(BackoffDelay(state->Settings, failures)), [this]()
+			{
+				return state->Stopping;
+			});
+			if (state->Stopping)
+				break;
+		}
+
+		state->Attempts++;
+		lock.unlock();
+		int result = recovering ? ClamirSession::Default().Connect() : ClamirFunctions::ConnectDevice();
+		lock.lock();
+		if (result == 0)
+		{
+			state->State = CONNECTION_CONNECTED;
+			state->Connects++;
+			// Losses reported while reconnecting refer to the old connection
+			state->Lost = false;
+			failures = 0;
+			state->Connected.notify_all();
+			if (recovering)
+			{
+				state->LastOutage = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - state->LostSince).count();
+				recovering = false;
+				// Catches up with a device that lost its settings, e.g. on a power cycle. Cached reads are served from the values of before the loss meanwhile
+				lock.unlock();
+				ClamirFunctions::RefreshParameters();
+				lock.lock();
+			}
+			continue;
+		}
+
+		state->LastError = result;
+		failures++;
+		if (state->Settings.MaxAttempts > 0 && failures >= state->Settings.MaxAttempts)
+		{
+			state->State = CONNECTION_FAILED;
+			state->Connected.notify_all();
+			// Stays idle until Stop
+			state->Wake.wait(lock, [this]() { return state->Stopping; });
+		}
+	}
+}
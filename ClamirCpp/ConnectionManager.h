@@ -0,0 +1,120 @@
+#pragma once
+
+#include <stdint.h>
+#include "ClamirExport.h"
+
+/**
+*Defaults of ConnectionSettings, in milliseconds
+*/
+#define CLAMIR_CONNECT_INITIAL_BACKOFF 10
+#define CLAMIR_CONNECT_MAX_BACKOFF 2000
+#define CLAMIR_HEALTH_INTERVAL 250
+
+struct ConnectionManagerState;
+
+enum ConnectionState
+{
+	CONNECTION_STOPPED = 0,
+	CONNECTION_CONNECTING,
+	CONNECTION_CONNECTED,
+	CONNECTION_FAILED
+};
+
+/**
+* @struct ConnectionSettings
+* @brief Reconnection policy of ConnectionManager
+* @param InitialBackoff Milliseconds between the first and second failed attempts, at least 1. The first attempt after a loss is made at once
+* @param MaxBackoff Upper bound of the delay, which doubles after every failed attempt
+* @param HealthInterval Milliseconds between two IsConnected polls while connected
+* @param MaxAttempts Failed attempts in a row after which the manager gives up with CONNECTION_FAILED, 0 to retry forever
+*/
+struct ConnectionSettings
+{
+	int InitialBackoff, MaxBackoff, HealthInterval, MaxAttempts;
+};
+
+/**
+* @struct ConnectionCounters
+* @brief Snapshot of the connection manager statistics
+* @param Attempts ConnectDevice calls made since Start
+* @param Connects Successful attempts, the first connection included
+* @param LinkLosses Losses detected, either by the health poll or by a closed connection returned by GetImage
+* @param HealthChecks IsConnected polls made
+* @param State One of the ConnectionState values
+* @param LastError Error code of the last failed attempt, 0 if none
+* @param LastOutage Milliseconds from the detection of the last loss to the reconnection, 0 if none
+*/
+struct ConnectionCounters
+{
+	uint64_t Attempts, Connects, LinkLosses, HealthChecks;
+	int State, LastError;
+	double LastOutage;
+};
+
+/**
+@class ConnectionManager
+@brief Background thread that connects to CLAMIR at the address of ClamirFunctions::SetDeviceAddress and keeps the connection alive
+
+*Start returns at once; the thread calls ClamirFunctions::ConnectDevice until it succeeds, waiting an exponentially growing delay between attempts.
+*While connected, the thread polls IsConnected every HealthInterval and is woken at once when GetImage returns a closed connection, through ClamirFunctions::SetConnectionLostCallback.
+*On a loss the device is disconnected and reconnected; a running background acquisition keeps its ring and resumes publishing frames when the connection is back.
+*A reconnection is a single ConnectCLAMIR round trip: the parameter cache of ClamirFunctions is kept across the loss and refreshed by the manager thread once connected, so WaitConnected does not wait for the roughly 45 reads of RefreshParameters.
+*Only the first connection prefetches the parameters before reporting CONNECTION_CONNECTED.
+*Only one manager can run at a time, since it owns the connection of ClamirFunctions.
+*/
+class CLAMIRLIBRARY_API ConnectionManager
+{
+public:
+	ConnectionManager();
+
+	/**
+	@brief Stops the manager if it is running
+	*/
+	~ConnectionManager();
+
+	ConnectionManager(const ConnectionManager&) = delete;
+	ConnectionManager& operator=(const ConnectionManager&) = delete;
+
+	static ConnectionSettings DefaultSettings();
+
+	/**
+	@brief Starts connecting in the background
+	@param settings Reconnection policy, or null for DefaultSettings
+	@returns 0 if the thread was started
+	@returns -1 if this or another manager is already running
+	@returns -3 on an InitialBackoff below 1, a MaxBackoff below InitialBackoff or a HealthInterval below 1
+	*/
+	int Start(const ConnectionSettings* settings = 0);
+
+	/**
+	@brief Stops the thread and disconnects the device. Waits for an attempt in progress to return
+	@returns 0 if the manager was stopped
+	@returns -1 if it was not running
+	*/
+	int Stop();
+
+	/**
+	@brief Current ConnectionState. Cheap enough to poll from a UI timer
+	*/
+	int State() const;
+
+	/**
+	@brief Blocks until the device is connected. Not meant for the UI thread
+	@returns 0 if connected
+	@returns -1 on timeout
+	@returns -2 if the manager is stopped or gave up
+	*/
+	int WaitConnected(int timeout);
+
+	/**
+	@brief Tells the manager that the connection was found closed, e.g. by a GetImage caller. Returns at once
+	*/
+	void ReportConnectionLost();
+
+	ConnectionCounters Counters() const;
+
+private:
+	void Run();
+
+	ConnectionManagerState* state;
+};
@@ -0,0 +1,243 @@
+#include "pch.h"
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include "DeviceCallStats.h"
+#include "BitOps.h"
+
+namespace
+{
+	const int sub_buckets = 1 << CLAMIR_LATENCY_SUB_BUCKET_BITS;
+
+	struct CallHistogram
+	{
+		std::atomic<uint64_t> Buckets[CLAMIR_LATENCY_BUCKETS];
+		std::atomic<uint64_t> Calls, Total, Max, Errors[3], OtherErrors;
+	};
+
+	// Zero initialized as static storage
+	CallHistogram histograms[CALL_COUNT];
+	std::atomic<bool> recording(true);
+
+	const char* const call_names[CALL_COUNT] =
+	{
+		"ConnectCLAMIR",
+		"DisconnectCLAMIR",
+		"IsConnected",
+		"GetImage",
+#define CLAMIR_DEVICE_CALL_NAME(name, ...) #name "Get", #name "Set",
+		CLAMIR_SCALAR_PARAMETERS(CLAMIR_DEVICE_CALL_NAME)
+#undef CLAMIR_DEVICE_CALL_NAME
+		"ROICoordinatesGet",
+		"ROICoordinatesSet",
+		"AutoShutterConfigurationGet",
+		"AutoShutterConfigurationSet",
+		"SerialNumberGet",
+		"EmbeddedSWVersion",
+		"AutoCalibrateSet",
+		"SaveEmbeddedConfigurationSet",
+	};
+
+	inline int BucketIndex(uint64_t nanoseconds)
+	{
+		if (nanoseconds < (uint64_t)sub_buckets)
+			return (int)nanoseconds;
+		int magnitude = HighestBit(nanoseconds);
+		if (magnitude >= CLAMIR_LATENCY_MAGNITUDES)
+			return CLAMIR_LATENCY_BUCKETS - 1;
+		int shift = magnitude - CLAMIR_LATENCY_SUB_BUCKET_BITS;
+		return ((shift + 1) << CLAMIR_LATENCY_SUB_BUCKET_BITS) + (int)((nanoseconds >> shift) & (sub_buckets - 1));
+	}
+
+	// Highest latency recorded in a bucket
+	inline uint64_t BucketUpperEdge(int index)
+	{
+		if (index < sub_buckets)
+			return (uint64_t)index;
+		int shift = (index >> CLAMIR_LATENCY_SUB_BUCKET_BITS) - 1;
+		uint64_t lower = (uint64_t)(sub_buckets + (index & (sub_buckets - 1))) << shift;
+		return lower + ((uint64_t)1 << shift) - 1;
+	}
+
+	struct MergedHistogram
+	{
+		uint64_t Buckets[CLAMIR_LATENCY_BUCKETS];
+		uint64_t Calls, Total, Max, Errors[3], OtherErrors;
+	};
+
+	void Clear(MergedHistogram* merged)
+	{
+		memset(merged, 0, sizeof(MergedHistogram));
+	}
+
+	void Merge(MergedHistogram* merged, const CallHistogram& histogram)
+	{
+		for (int i = 0; i < CLAMIR_LATENCY_BUCKETS; i++)
+			merged->Buckets[i] += histogram.Buckets[i].load(std::memory_order_relaxed);
+		merged->Calls += histogram.Calls.load(std::memory_order_relaxed);
+		merged->Total += histogram.Total.load(std::memory_order_relaxed);
+		uint64_t max = histogram.Max.load(std::memory_order_relaxed);
+		if (max > merged->Max)
+			merged->Max = max;
+		for (int i = 0; i < 3; i++)
+			merged->Errors[i] += histogram.Errors[i].load(std::memory_order_relaxed);
+		merged->OtherErrors += histogram.OtherErrors.load(std::memory_order_relaxed);
+	}
+
+	double Percentile(const MergedHistogram& merged, uint64_t counted, double quantile)
+	{
+		if (counted == 0)
+			return 0.0;
+		uint64_t rank = (uint64_t)(quantile * counted + 0.5);
+		if (rank < 1)
+			rank = 1;
+		uint64_t cumulative = 0;
+		for (int i = 0; i < CLAMIR_LATENCY_BUCKETS; i++)
+		{
+			cumulative += merged.Buckets[i];
+			if (cumulative >= rank)
+			{
+				uint64_t edge = BucketUpperEdge(i);
+				return (edge < merged.Max ? edge : merged.Max) / 1000.0;
+			}
+		}
+		return merged.Max / 1000.0;
+	}
+
+	void Summarize(const MergedHistogram& merged, DeviceCallSnapshot* snapshot)
+	{
+		// Buckets and Calls are read one after the other, so concurrent records may make them disagree by a few calls; percentiles use the bucket total
+		uint64_t counted = 0;
+		for (int i = 0; i < CLAMIR_LATENCY_BUCKETS; i++)
+			counted += merged.Buckets[i];
+		snapshot->Calls = merged.Calls;
+		for (int i = 0; i < 3; i++)
+			snapshot->Errors[i] = merged.Errors[i];
+		snapshot->OtherErrors = merged.OtherErrors;
+		snapshot->Mean = merged.Calls > 0 ? merged.Total / 1000.0 / merged.Calls : 0.0;
+		snapshot->P50 = Percentile(merged, counted, 0.5);
+		snapshot->P90 = Percentile(merged, counted, 0.9);
+		snapshot->P99 = Percentile(merged, counted, 0.99);
+		snapshot->P999 = Percentile(merged, counted, 0.999);
+		snapshot->Max = merged.Max / 1000.0;
+	}
+
+	int WriteLine(FILE* file, const char* name, const DeviceCallSnapshot& snapshot)
+	{
+		return fprintf(file, "%-34s %10llu %8llu %8llu %10llu %8llu %12.1f %12.1f %12.1f %12.1f %12.1f %12.1f\n", name,
+			(unsigned long long)snapshot.Calls, (unsigned long long)snapshot.Errors[0], (unsigned long long)snapshot.Errors[1],
+			(unsigned long long)snapshot.Errors[2], (unsigned long long)snapshot.OtherErrors,
+			snapshot.Mean, snapshot.P50, snapshot.P90, snapshot.P99, snapshot.P999, snapshot.Max) < 0 ? -1 : 0;
+	}
+}
+
+void DeviceCallStats::SetEnabled(bool enabled)
+{
+	recording.store(enabled, std::memory_order_relaxed);
+}
+
+bool DeviceCallStats::Enabled()
+{
+	return recording.load(std::memory_order_relaxed);
+}
+
+uint64_t DeviceCallStats::Now()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void DeviceCallStats::Record(int call, uint64_t start, int result)
+{
+	if (call < 0 || call >= CALL_COUNT)
+		return;
+	uint64_t elapsed = Now() - start;
+	CallHistogram& histogram = histograms[call];
+	histogram.Buckets[BucketIndex(elapsed)].fetch_add(1, std::memory_order_relaxed);
+	histogram.Calls.fetch_add(1, std::memory_order_relaxed);
+	histogram.Total.fetch_add(elapsed, std::memory_order_relaxed);
+	uint64_t max = histogram.Max.load(std::memory_order_relaxed);
+	while (elapsed > max && !histogram.Max.compare_exchange_weak(max, elapsed, std::memory_order_relaxed))
+	{
+	}
+	if (result >= -3 && result <= -1)
+		histogram.Errors[-result - 1].fetch_add(1, std::memory_order_relaxed);
+	else if (result != 0)
+		histogram.OtherErrors.fetch_add(1, std::memory_order_relaxed);
+}
+
+const char* DeviceCallStats::Name(int call)
+{
+	return call >= 0 && call < CALL_COUNT ? call_names[call] : 0;
+}
+
+int DeviceCallStats::Snapshot(int call, DeviceCallSnapshot* snapshot)
+{
+	if (call < 0 || call >= CALL_COUNT)
+		return -3;
+	MergedHistogram merged;
+	Clear(&merged);
+	Merge(&merged, histograms[call]);
+	Summarize(merged, snapshot);
+	return 0;
+}
+
+int DeviceCallStats::ChannelSnapshot(int channel, DeviceCallSnapshot* snapshot)
+{
+	if (channel != CHANNEL_IMAGE && channel != CHANNEL_COMMAND)
+		return -3;
+	MergedHistogram merged;
+	Clear(&merged);
+	for (int call = 0; call < CALL_COUNT; call++)
+		if ((call == CALL_GetImage) == (channel == CHANNEL_IMAGE))
+			Merge(&merged, histograms[call]);
+	Summarize(merged, snapshot);
+	return 0;
+}
+
+void DeviceCallStats::Reset()
+{
+	for (int call = 0; call < CALL_COUNT; call++)
+	{
+		CallHistogram& histogram = histograms[call];
+		for (int i = 0; i < CLAMIR_LATENCY_BUCKETS; i++)
+			histogram.Buckets[i].store(0, std::memory_order_relaxed);
+		histogram.Calls.store(0, std::memory_order_relaxed);
+		histogram.Total.store(0, std::memory_order_relaxed);
+		histogram.Max.store(0, std::memory_order_relaxed);
+		for (int i = 0; i < 3; i++)
+			histogram.Errors[i].store(0, std::memory_order_relaxed);
+		histogram.OtherErrors.store(0, std::memory_order_relaxed);
+	}
+}
+
+int DeviceCallStats::Dump(FILE* file)
+{
+	if (fprintf(file, "%-34s %10s %8s %8s %10s %8s %12s %12s %12s %12s %12s %12s\n", "call", "calls", "timeout", "comm", "closed/oob", "other",
+		"mean_us", "p50_us", "p90_us", "p99_us", "p99.9_us", "max_us") < 0)
+		return -1;
+
+	DeviceCallSnapshot snapshot;
+	ChannelSnapshot(CHANNEL_IMAGE, &snapshot);
+	int result = WriteLine(file, "[image channel]", snapshot);
+	ChannelSnapshot(CHANNEL_COMMAND, &snapshot);
+	if (result == 0)
+		result = WriteLine(file, "[command channel]", snapshot);
+	for (int call = 0; call < CALL_COUNT && result == 0; call++)
+	{
+		Snapshot(call, &snapshot);
+		if (snapshot.Calls > 0)
+			result = WriteLine(file, call_names[call], snapshot);
+	}
+	return result;
+}
+
+int DeviceCallStats::Dump(const char* path)
+{
+	FILE* file = fopen(path, "w");
+	if (!file)
+		return -1;
+	int result = Dump(file);
+	if (fclose(file) != 0)
+		result = -1;
+	return result;
+}
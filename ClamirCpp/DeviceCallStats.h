@@ -0,0 +1,139 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include "ClamirParameters.h"
+#include "ClamirExport.h"
+
+/**
+*Latency histograms are log-linear like HDR histograms: below 2^CLAMIR_LATENCY_SUB_BUCKET_BITS nanoseconds every value has its bucket, above it every power of two is split into 2^CLAMIR_LATENCY_SUB_BUCKET_BITS buckets.
+*With 4 bits a recorded value is within 6.25% of the true latency. Latencies of 2^CLAMIR_LATENCY_MAGNITUDES nanoseconds (18 minutes) or more share the last bucket.
+*/
+#define CLAMIR_LATENCY_SUB_BUCKET_BITS 4
+#define CLAMIR_LATENCY_MAGNITUDES 40
+#define CLAMIR_LATENCY_BUCKETS ((CLAMIR_LATENCY_MAGNITUDES - CLAMIR_LATENCY_SUB_BUCKET_BITS + 1) << CLAMIR_LATENCY_SUB_BUCKET_BITS)
+
+/**
+*Every CLAMIR_dll.h function called by ClamirCpp
+*/
+enum DeviceCall
+{
+	CALL_ConnectCLAMIR = 0,
+	CALL_DisconnectCLAMIR,
+	CALL_IsConnected,
+	CALL_GetImage,
+#define CLAMIR_DEVICE_CALL_ID(name, ...) CALL_##name##Get, CALL_##name##Set,
+	CLAMIR_SCALAR_PARAMETERS(CLAMIR_DEVICE_CALL_ID)
+#undef CLAMIR_DEVICE_CALL_ID
+	CALL_ROICoordinatesGet,
+	CALL_ROICoordinatesSet,
+	CALL_AutoShutterConfigurationGet,
+	CALL_AutoShutterConfigurationSet,
+	CALL_SerialNumberGet,
+	CALL_EmbeddedSWVersion,
+	CALL_AutoCalibrateSet,
+	CALL_SaveEmbeddedConfigurationSet,
+	CALL_COUNT
+};
+
+enum DeviceChannel
+{
+	CHANNEL_IMAGE = 0,
+	CHANNEL_COMMAND
+};
+
+/**
+* @struct DeviceCallSnapshot
+* @brief Latency distribution and result codes of one function, or of every function of a channel
+* @param Calls Calls recorded
+* @param Errors Errors[i] counts the calls that returned -(i + 1): -1 timeout, -2 communication error, -3 closed connection for GetImage or out of bounds value for a Set. Errors[2] of the image channel thus counts closed connections and that of the command channel out of bounds values
+* @param OtherErrors Calls that returned another nonzero code
+* @param Mean P50 P90 P99 P999 Max Latencies in microseconds. Percentiles are the upper edge of their bucket, so they never underestimate
+*/
+struct DeviceCallSnapshot
+{
+	uint64_t Calls, Errors[3], OtherErrors;
+	double Mean, P50, P90, P99, P999, Max;
+};
+
+/**
+@class DeviceCallStats
+@brief Process wide latency histograms and error counters of the CLAMIR_dll.h functions
+
+*Every call made by ClamirCpp goes through TimedDeviceCall, which costs two clock reads and a few relaxed atomic increments, so the histograms can stay enabled in production.
+*GetImage is the image channel; every other function goes over the command channel, which tells a slow image stream from slow commands when timeouts appear.
+*/
+class CLAMIRLIBRARY_API DeviceCallStats
+{
+public:
+	/**
+	@brief Enables or disables the recording. Enabled by default
+	*/
+	static void SetEnabled(bool enabled);
+	static bool Enabled();
+
+	/**
+	@brief Monotonic clock in nanoseconds, also used for the FrameTrace timestamps
+	*/
+	static uint64_t Now();
+
+	/**
+	@brief Records a call that started at start, as returned by Now, and returned result
+	*/
+	static void Record(int call, uint64_t start, int result);
+
+	/**
+	@brief Name of the CLAMIR_dll.h function, or null for an unknown call
+	*/
+	static const char* Name(int call);
+
+	/**
+	@returns 0 on success
+	@returns -3 for an unknown call
+	*/
+	static int Snapshot(int call, DeviceCallSnapshot* snapshot);
+
+	/**
+	@brief Merges the functions of a channel
+	@param channel One of the DeviceChannel values
+	@returns 0 on success
+	@returns -3 for an unknown channel
+	*/
+	static int ChannelSnapshot(int channel, DeviceCallSnapshot* snapshot);
+
+	static void Reset();
+
+	/**
+	@brief Writes one text line per channel and per function called at least once, e.g. to stderr or a log file
+	*The error columns count -1, -2 and -3; the -3 column is labelled closed/oob since it counts closed connections for GetImage and out of bounds values for the other functions.
+	@returns 0 on success
+	@returns -1 on a write error
+	*/
+	static int Dump(FILE* file);
+
+	/**
+	@brief Dumps to a file, replacing it
+	@returns 0 on success
+	@returns -1 if the file cannot be written
+	*/
+	static int Dump(const char* path);
+};
+
+/**
+@brief Calls function, which makes one CLAMIR_dll.h call and returns its result, and records it as call
+*/
+template <typename F>
+inline int TimedDeviceCall(int call, F function)
+{
+	if (!DeviceCallStats::Enabled())
+		return function();
+	uint64_t start = DeviceCallStats::Now();
+	int result = function();
+	DeviceCallStats::Record(call, start, result);
+	return result;
+}
+
+/**
+*Timed call of a CLAMIR_dll.h function, e.g. CLAMIR_DEVICE_CALL(KPSet, data)
+*/
+#define CLAMIR_DEVICE_CALL(name, ...) TimedDeviceCall(CALL_##name, [&]() { return ::name(__VA_ARGS__); })
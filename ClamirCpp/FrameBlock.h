@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+#include "ClamirFrame.h"
+#include "CImg.h"
+
+/**
+@struct FrameBlock
+@brief Structure-of-arrays block of consecutive CLAMIR frames, filled by ClamirFunctions::GetFrames
+
+*Images are stored as the slices of a 64x64xN volume, so pixel (x, y) of frame z is Images(x, y, z) and all pixels of one frame are contiguous.
+*Each ImageHeader field has its own array indexed by frame. Only the first Count entries are valid.
+*Resizing to the same number of frames does not reallocate, so a block can be reused across calls without heap traffic.
+*/
+struct FrameBlock
+{
+	int Count;
+	cimg_library::CImg<int16_t> Images;
+
+	std::vector<int> Power, MeltPoolArea, TrackNum, FrameMax, FrameNum;
+	std::vector<float> Width, RefWidth, Temperature;
+	std::vector<char> LaserStatus, StateMachine;
+	std::vector<int16_t> IODigitalPortStatus;
+
+	FrameBlock() : Count(0)
+	{
+	}
+
+	/**
+	@brief Makes room for n frames and sets Count to 0
+	*/
+	void Resize(int n)
+	{
+		Count = 0;
+		Images.assign(CLAMIR_IMAGE_WIDTH, CLAMIR_IMAGE_HEIGHT, n, 1);
+		Power.resize(n);
+		MeltPoolArea.resize(n);
+		TrackNum.resize(n);
+		FrameMax.resize(n);
+		FrameNum.resize(n);
+		Width.resize(n);
+		RefWidth.resize(n);
+		Temperature.resize(n);
+		LaserStatus.resize(n);
+		StateMachine.resize(n);
+		IODigitalPortStatus.resize(n);
+	}
+
+	int16_t* Image(int i)
+	{
+		return Images.data(0, 0, i);
+	}
+
+	/**
+	@brief Scatters a header into the field arrays at index i
+	*/
+	void SetHeader(int i, const ImageHeader& header)
+	{
+		Power[i] = header.Power;
+		MeltPoolArea[i] = header.MeltPoolArea;
+		TrackNum[i] = header.TrackNum;
+		FrameMax[i] = header.FrameMax;
+		FrameNum[i] = header.FrameNum;
+		Width[i] = header.Width;
+		RefWidth[i] = header.RefWidth;
+		Temperature[i] = header.Temperature;
+		LaserStatus[i] = header.LaserStatus;
+		StateMachine[i] = header.StateMachine;
+		IODigitalPortStatus[i] = header.IODigitalPortStatus;
+	}
+};
@@ -0,0 +1,240 @@
+#include "pch.h"
+#include <string.h>
+#include "FrameCodec.h"
+
+#ifdef CLAMIR_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef CLAMIR_AVX2
+#include <immintrin.h>
+#endif
+
+#define CODEC_TAG_DELTA_PACKED 1
+
+namespace
+{
+	inline uint16_t ZigZag(uint16_t residual)
+	{
+		return (uint16_t)((residual << 1) ^ (uint16_t)((int16_t)residual >> 15));
+	}
+
+	inline uint16_t UnZigZag(uint16_t value)
+	{
+		return (uint16_t)((value >> 1) ^ (uint16_t)(0 - (value & 1)));
+	}
+
+	inline int BitWidth(unsigned int value)
+	{
+		int width = 0;
+		while (value)
+		{
+			width++;
+			value >>= 1;
+		}
+		return width;
+	}
+
+	// Nibble 15 stands for 16 bits, so 15 bit blocks are stored on 16 bits
+	inline int StoredWidth(int nibble)
+	{
+		return nibble == 15 ? 16 : nibble;
+	}
+
+	// Zigzag mapped residuals of the whole image
+	void Residuals(const int16_t* image, uint16_t* residuals)
+	{
+		uint16_t previous = 0;
+		for (int x = 0; x < CLAMIR_IMAGE_WIDTH; x++)
+		{
+			residuals[x] = ZigZag((uint16_t)(image[x] - previous));
+			previous = (uint16_t)image[x];
+		}
+
+		int i = CLAMIR_IMAGE_WIDTH;
+#if defined(CLAMIR_AVX2)
+		for (; i < CLAMIR_IMAGE_PIXELS; i += 16)
+		{
+			__m256i current = _mm256_loadu_si256((const __m256i*)(image + i));
+			__m256i above = _mm256_loadu_si256((const __m256i*)(image + i - CLAMIR_IMAGE_WIDTH));
+			__m256i residual = _mm256_sub_epi16(current, above);
+			__m256i zigzag = _mm256_xor_si256(_mm256_slli_epi16(residual, 1), _mm256_srai_epi16(residual, 15));
+			_mm256_storeu_si256((__m256i*)(residuals + i), zigzag);
+		}
+#elif defined(CLAMIR_SSE2)
+		for (; i < CLAMIR_IMAGE_PIXELS; i += 8)
+		{
+			__m128i current = _mm_loadu_si128((const __m128i*)(image + i));
+			__m128i above = _mm_loadu_si128((const __m128i*)(image + i - CLAMIR_IMAGE_WIDTH));
+			__m128i residual = _mm_sub_epi16(current, above);
+			__m128i zigzag = _mm_xor_si128(_mm_slli_epi16(residual, 1), _mm_srai_epi16(residual, 15));
+			_mm_storeu_si128((__m128i*)(residuals + i), zigzag);
+		}
+#endif
+		for (; i < CLAMIR_IMAGE_PIXELS; i++)
+			residuals[i] = ZigZag((uint16_t)(image[i] - image[i - CLAMIR_IMAGE_WIDTH]));
+	}
+
+	// Bitwise OR of the 16 residuals of a block, whose bit length is the block width
+	inline unsigned int BlockBits(const uint16_t* block)
+	{
+#if defined(CLAMIR_SSE2)
+		__m128i bits = _mm_or_si128(_mm_loadu_si128((const __m128i*)block), _mm_loadu_si128((const __m128i*)(block + 8)));
+		bits = _mm_or_si128(bits, _mm_srli_si128(bits, 8));
+		bits = _mm_or_si128(bits, _mm_srli_si128(bits, 4));
+		bits = _mm_or_si128(bits, _mm_srli_si128(bits, 2));
+		return (unsigned int)_mm_extract_epi16(bits, 0);
+#else
+		unsigned int bits = 0;
+		for (int i = 0; i < CLAMIR_CODEC_BLOCK_PIXELS; i++)
+			bits |= block[i];
+		return bits;
+#endif
+	}
+
+	// A block of 16 values of width bits is exactly 2 * width bytes, so the accumulator is flushed 32 bits at a time and ends empty
+	uint8_t* PackBlock(const uint16_t* block, int width, uint8_t* out)
+	{
+		if (width == 16)
+		{
+			memcpy(out, block, CLAMIR_CODEC_BLOCK_PIXELS * sizeof(uint16_t));
+			return out + CLAMIR_CODEC_BLOCK_PIXELS * sizeof(uint16_t);
+		}
+		uint64_t accumulator = 0;
+		int bits = 0;
+		for (int i = 0; i < CLAMIR_CODEC_BLOCK_PIXELS; i++)
+		{
+			accumulator |= (uint64_t)block[i] << bits;
+			bits += width;
+			if (bits >= 32)
+			{
+				uint32_t word = (uint32_t)accumulator;
+				memcpy(out, &word, sizeof(word));
+				out += sizeof(word);
+				accumulator >>= 32;
+				bits -= 32;
+			}
+		}
+		while (bits > 0)
+		{
+			*out++ = (uint8_t)accumulator;
+			accumulator >>= 8;
+			bits -= 8;
+		}
+		return out;
+	}
+
+	const uint8_t* UnpackBlock(const uint8_t* in, int width, uint16_t* block)
+	{
+		if (width == 0)
+		{
+			memset(block, 0, CLAMIR_CODEC_BLOCK_PIXELS * sizeof(uint16_t));
+			return in;
+		}
+		if (width == 16)
+		{
+			memcpy(block, in, CLAMIR_CODEC_BLOCK_PIXELS * sizeof(uint16_t));
+			return in + CLAMIR_CODEC_BLOCK_PIXELS * sizeof(uint16_t);
+		}
+		uint64_t accumulator = 0;
+		int bits = 0;
+		const uint8_t* end = in + 2 * width;
+		uint16_t mask = (uint16_t)((1u << width) - 1);
+		for (int i = 0; i < CLAMIR_CODEC_BLOCK_PIXELS; i++)
+		{
+			if (bits < width)
+			{
+				// Refill 32 bits at a time, byte by byte on the last bytes of the block so nothing past it is read
+				if (end - in >= 4)
+				{
+					uint32_t word;
+					memcpy(&word, in, sizeof(word));
+					accumulator |= (uint64_t)word << bits;
+					in += sizeof(word);
+					bits += 32;
+				}
+				else
+				{
+					while (bits < width)
+					{
+						accumulator |= (uint64_t)*in++ << bits;
+						bits += 8;
+					}
+				}
+			}
+			block[i] = (uint16_t)(accumulator & mask);
+			accumulator >>= width;
+			bits -= width;
+		}
+		return in;
+	}
+}
+
+size_t FrameCodec::Encode(const int16_t* aImage, uint8_t* encoded)
+{
+	alignas(32) uint16_t residuals[CLAMIR_IMAGE_PIXELS];
+	Residuals(aImage, residuals);
+
+	uint8_t* widths = encoded + 1;
+	uint8_t* out = widths + CLAMIR_CODEC_BLOCKS / 2;
+	encoded[0] = CODEC_TAG_DELTA_PACKED;
+	for (int b = 0; b < CLAMIR_CODEC_BLOCKS; b += 2)
+	{
+		const uint16_t* first = residuals + b * CLAMIR_CODEC_BLOCK_PIXELS;
+		const uint16_t* second = first + CLAMIR_CODEC_BLOCK_PIXELS;
+		int firstNibble = BitWidth(BlockBits(first));
+		int secondNibble = BitWidth(BlockBits(second));
+		if (firstNibble > 15)
+			firstNibble = 15;
+		if (secondNibble > 15)
+			secondNibble = 15;
+		widths[b / 2] = (uint8_t)(firstNibble | secondNibble << 4);
+		out = PackBlock(first, StoredWidth(firstNibble), out);
+		out = PackBlock(second, StoredWidth(secondNibble), out);
+	}
+	return (size_t)(out - encoded);
+}
+
+bool FrameCodec::Decode(const uint8_t* encoded, size_t length, int16_t* aImage)
+{
+	size_t header = 1 + CLAMIR_CODEC_BLOCKS / 2;
+	if (length < header || encoded[0] != CODEC_TAG_DELTA_PACKED)
+		return false;
+
+	const uint8_t* widths = encoded + 1;
+	size_t needed = header;
+	for (int b = 0; b < CLAMIR_CODEC_BLOCKS / 2; b++)
+		needed += 2 * (StoredWidth(widths[b] & 15) + StoredWidth(widths[b] >> 4));
+	if (length < needed)
+		return false;
+
+	alignas(32) uint16_t residuals[CLAMIR_IMAGE_PIXELS];
+	const uint8_t* in = encoded + header;
+	for (int b = 0; b < CLAMIR_CODEC_BLOCKS; b++)
+	{
+		int nibble = b & 1 ? widths[b / 2] >> 4 : widths[b / 2] & 15;
+		in = UnpackBlock(in, StoredWidth(nibble), residuals + b * CLAMIR_CODEC_BLOCK_PIXELS);
+	}
+
+	uint16_t previous = 0;
+	for (int x = 0; x < CLAMIR_IMAGE_WIDTH; x++)
+	{
+		previous = (uint16_t)(previous + UnZigZag(residuals[x]));
+		aImage[x] = (int16_t)previous;
+	}
+
+	int i = CLAMIR_IMAGE_WIDTH;
+#if defined(CLAMIR_SSE2)
+	const __m128i one = _mm_set1_epi16(1);
+	const __m128i zero = _mm_setzero_si128();
+	for (; i < CLAMIR_IMAGE_PIXELS; i += 8)
+	{
+		__m128i value = _mm_load_si128((const __m128i*)(residuals + i));
+		__m128i residual = _mm_xor_si128(_mm_srli_epi16(value, 1), _mm_sub_epi16(zero, _mm_and_si128(value, one)));
+		__m128i above = _mm_loadu_si128((const __m128i*)(aImage + i - CLAMIR_IMAGE_WIDTH));
+		_mm_storeu_si128((__m128i*)(aImage + i), _mm_add_epi16(above, residual));
+	}
+#endif
+	for (; i < CLAMIR_IMAGE_PIXELS; i++)
+		aImage[i] = (int16_t)(aImage[i - CLAMIR_IMAGE_WIDTH] + UnZigZag(residuals[i]));
+	return true;
+}
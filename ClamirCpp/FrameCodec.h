@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stddef.h>
+#include "ClamirFrame.h"
+#include "ClamirExport.h"
+
+#define CLAMIR_CODEC_BLOCK_PIXELS 16
+#define CLAMIR_CODEC_BLOCKS (CLAMIR_IMAGE_PIXELS / CLAMIR_CODEC_BLOCK_PIXELS)
+
+// Tag byte + one width nibble per block + every block at 16 bits
+#define CLAMIR_CODEC_MAX_BYTES (1 + CLAMIR_CODEC_BLOCKS / 2 + CLAMIR_IMAGE_PIXELS * 2)
+
+/**
+@class FrameCodec
+@brief Lossless codec for 64x64 int16_t CLAMIR images
+
+*Each pixel is predicted from the pixel above it (from its left neighbour on the first row), the residuals are zigzag mapped to small unsigned values and packed in blocks of 16 pixels using the bit width of the largest residual of the block.
+*Flat background compresses to a few bits per pixel and runs of identical pixels to a single width nibble per block.
+*Prediction, zigzag mapping and the block widths are vectorized with SSE2, or AVX2 when the build enables it.
+*/
+class CLAMIRLIBRARY_API FrameCodec
+{
+public:
+	/**
+	@brief Encodes an image
+	@param aImage Pointer to an array of 4096 int16_t pixels
+	@param encoded Buffer of at least CLAMIR_CODEC_MAX_BYTES bytes
+	@returns the number of bytes written
+	*/
+	static size_t Encode(const int16_t* aImage, uint8_t* encoded);
+
+	/**
+	@brief Decodes an image written by Encode
+	@param encoded Encoded bytes
+	@param length Number of encoded bytes
+	@param aImage Pointer to an array of 4096 int16_t pixels
+	@returns true on success, false if the data is truncated or not an encoded image
+	*/
+	static bool Decode(const uint8_t* encoded, size_t length, int16_t* aImage);
+};
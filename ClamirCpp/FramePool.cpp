@@ -0,0 +1,194 @@
+#include "pch.h"
+#include <atomic>
+#include <new>
+#include <utility>
+#include "FramePool.h"
+
+using namespace cimg_library;
+
+#define FRAME_POOL_EMPTY 0xFFFFFFFFu
+
+struct FramePoolSlot
+{
+	ClamirFrame Frame;
+	std::atomic<int> RefCount;
+	std::atomic<uint32_t> NextFree;
+	uint32_t Index;
+	FramePoolState* State;
+};
+
+// Head of the lock-free free list: slot index in the low 32 bits, ABA tag in the high 32 bits.
+// Holders counts the pool object plus every leased slot; the last one to go frees the slots and the state
+struct FramePoolState
+{
+	std::atomic<uint64_t> FreeHead;
+	std::atomic<int> Available;
+	std::atomic<int> Holders;
+	FramePoolSlot* Slots;
+	int SlotCount;
+};
+
+namespace
+{
+	void DropHolder(FramePoolState* state)
+	{
+		if (state->Holders.fetch_sub(1, std::memory_order_acq_rel) != 1)
+			return;
+		for (int i = 0; i < state->SlotCount; i++)
+			state->Slots[i].~FramePoolSlot();
+		ClamirAlignedFree(state->Slots);
+		delete state;
+	}
+}
+
+FrameLease::FrameLease() : slot(0)
+{
+}
+
+FrameLease::FrameLease(FramePoolSlot* aSlot) : slot(aSlot)
+{
+}
+
+FrameLease::FrameLease(const FrameLease& other) : slot(other.slot)
+{
+	if (slot)
+		slot->RefCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+FrameLease::FrameLease(FrameLease&& other) : slot(other.slot)
+{
+	other.slot = 0;
+}
+
+FrameLease& FrameLease::operator=(const FrameLease& other)
+{
+	if (other.slot)
+		other.slot->RefCount.fetch_add(1, std::memory_order_relaxed);
+	Reset();
+	slot = other.slot;
+	return *this;
+}
+
+FrameLease& FrameLease::operator=(FrameLease&& other)
+{
+	if (this != &other)
+	{
+		Reset();
+		slot = other.slot;
+		other.slot = 0;
+	}
+	return *this;
+}
+
+FrameLease::~FrameLease()
+{
+	Reset();
+}
+
+void FrameLease::Reset()
+{
+	if (!slot)
+		return;
+	if (slot->RefCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		FramePool::Release(slot);
+	slot = 0;
+}
+
+ClamirFrame* FrameLease::Frame() const
+{
+	return slot ? &slot->Frame : 0;
+}
+
+ImageHeader* FrameLease::Header() const
+{
+	return slot ? &slot->Frame.Header : 0;
+}
+
+int16_t* FrameLease::Image() const
+{
+	return slot ? slot->Frame.Image : 0;
+}
+
+CImg<int16_t> FrameLease::View() const
+{
+	if (!slot)
+		return CImg<int16_t>();
+	return CImg<int16_t>(slot->Frame.Image, CLAMIR_IMAGE_WIDTH, CLAMIR_IMAGE_HEIGHT, 1, 1, true);
+}
+
+FramePool::FramePool(int aSlotCount) : slots(0), state(0), slotCount(aSlotCount > 0 ? aSlotCount : 1)
+{
+	slots = static_cast<FramePoolSlot*>(ClamirAlignedAlloc(sizeof(FramePoolSlot) * slotCount, CLAMIR_CACHE_LINE));
+	if (!slots)
+		throw std::bad_alloc();
+	state = new FramePoolState();
+
+	for (int i = 0; i < slotCount; i++)
+	{
+		FramePoolSlot* s = new (&slots[i]) FramePoolSlot();
+		s->RefCount.store(0, std::memory_order_relaxed);
+		s->NextFree.store(i + 1 < slotCount ? (uint32_t)(i + 1) : FRAME_POOL_EMPTY, std::memory_order_relaxed);
+		s->Index = (uint32_t)i;
+		s->State = state;
+	}
+	state->FreeHead.store(0, std::memory_order_relaxed);
+	state->Available.store(slotCount, std::memory_order_relaxed);
+	state->Holders.store(1, std::memory_order_relaxed);
+	state->Slots = slots;
+	state->SlotCount = slotCount;
+}
+
+FramePool::~FramePool()
+{
+	// Leased slots keep the storage alive until their last lease is released
+	DropHolder(state);
+}
+
+bool FramePool::Acquire(FrameLease* lease)
+{
+	lease->Reset();
+
+	uint64_t head = state->FreeHead.load(std::memory_order_acquire);
+	for (;;)
+	{
+		uint32_t index = (uint32_t)head;
+		if (index == FRAME_POOL_EMPTY)
+			return false;
+		uint32_t next = slots[index].NextFree.load(std::memory_order_relaxed);
+		uint64_t updated = ((head >> 32) + 1) << 32 | next;
+		if (state->FreeHead.compare_exchange_weak(head, updated, std::memory_order_acq_rel, std::memory_order_acquire))
+			break;
+	}
+
+	FramePoolSlot* s = &slots[(uint32_t)head];
+	s->RefCount.store(1, std::memory_order_relaxed);
+	state->Available.fetch_sub(1, std::memory_order_relaxed);
+	state->Holders.fetch_add(1, std::memory_order_relaxed);
+	lease->slot = s;
+	return true;
+}
+
+void FramePool::Release(FramePoolSlot* aSlot)
+{
+	FramePoolState* state = aSlot->State;
+	uint64_t head = state->FreeHead.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		aSlot->NextFree.store((uint32_t)head, std::memory_order_relaxed);
+		uint64_t updated = ((head >> 32) + 1) << 32 | aSlot->Index;
+		if (state->FreeHead.compare_exchange_weak(head, updated, std::memory_order_release, std::memory_order_relaxed))
+			break;
+	}
+	state->Available.fetch_add(1, std::memory_order_relaxed);
+	DropHolder(state);
+}
+
+int FramePool::Capacity() const
+{
+	return slotCount;
+}
+
+int FramePool::Available() const
+{
+	return state->Available.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "ClamirFrame.h"
+#include "CImg.h"
+#include "ClamirExport.h"
+
+struct FramePoolSlot;
+struct FramePoolState;
+class FramePool;
+
+/**
+@class FrameLease
+@brief Reference-counted handle to one frame slot of a FramePool
+
+*Copying a lease shares the slot, moving it transfers ownership without touching the reference count. The slot goes back to its pool when the last lease referencing it is reset or destroyed, from any thread.
+*A lease may outlive its pool: the slots are freed once the pool is destroyed and the last lease taken from it is released.
+*/
+class CLAMIRLIBRARY_API FrameLease
+{
+public:
+	FrameLease();
+	FrameLease(const FrameLease& other);
+	FrameLease(FrameLease&& other);
+	FrameLease& operator=(const FrameLease& other);
+	FrameLease& operator=(FrameLease&& other);
+	~FrameLease();
+
+	/**
+	@brief Drops this reference, returning the slot to the pool if it was the last one
+	*/
+	void Reset();
+
+	bool IsValid() const { return slot != 0; }
+	ClamirFrame* Frame() const;
+	ImageHeader* Header() const;
+	int16_t* Image() const;
+
+	/**
+	@brief Returns a 64x64 CImg sharing the slot pixels. No copy and no allocation; the view is only valid while a lease on the slot is held
+	*/
+	cimg_library::CImg<int16_t> View() const;
+
+private:
+	friend class FramePool;
+	explicit FrameLease(FramePoolSlot* aSlot);
+
+	FramePoolSlot* slot;
+};
+
+/**
+@class FramePool
+@brief Fixed set of preallocated, cache-line aligned frame slots handed out as FrameLease
+
+*All memory is allocated by the constructor; Acquire and the release of leases never touch the heap. The free list is lock-free, so leases can be taken by the acquisition thread and released by any consumer thread.
+*/
+class CLAMIRLIBRARY_API FramePool
+{
+public:
+	explicit FramePool(int slotCount);
+	~FramePool();
+
+	FramePool(const FramePool&) = delete;
+	FramePool& operator=(const FramePool&) = delete;
+
+	/**
+	@brief Takes a free slot
+	@param lease Lease that will reference the slot. Any slot it referenced before is released first
+	@returns true if a slot was taken, false if every slot is leased
+	*/
+	bool Acquire(FrameLease* lease);
+
+	int Capacity() const;
+	int Available() const;
+
+private:
+	friend class FrameLease;
+	static void Release(FramePoolSlot* aSlot);
+
+	FramePoolSlot* slots;
+	FramePoolState* state;
+	int slotCount;
+};
@@ -0,0 +1,370 @@
+#include "pch.h"
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include "FrameRecorder.h"
+#include "FrameCodec.h"
+#include "RawHeader.h"
+#include "FrameTrace.h"
+
+namespace
+{
+	// Mapped window of the writer and of the reader records. Large enough that remapping is rare, small enough to keep the address space use bounded
+	const uint64_t view_bytes = 64ull << 20;
+
+	// Mapped window of the reader index, 128k frames
+	const size_t index_view_bytes = 1 << 20;
+
+	// Index entries kept in memory before they are spilled to disk
+	const size_t index_buffer_entries = 1 << 16;
+
+	// Growth step of the spill file, 16 spills
+	const uint64_t spill_grow_bytes = 8ull << 20;
+
+	const size_t raw_payload_bytes = CLAMIR_IMAGE_PIXELS * sizeof(int16_t);
+
+	uint64_t PaddedPayload(uint32_t payloadBytes)
+	{
+		return (payloadBytes + 3u) & ~3ull;
+	}
+
+	long long MicrosecondsNow()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+}
+
+FrameRecorder::FrameRecorder()
+	: frameCount(0), openTime(0), failed(false), compress(false)
+{
+}
+
+FrameRecorder::~FrameRecorder()
+{
+	Close();
+}
+
+int FrameRecorder::Open(const char* path, uint64_t preallocateBytes)
+{
+	Close();
+	if (!file.Create(path, preallocateBytes, view_bytes))
+		return -1;
+	if (telemetry.Open((std::string(path) + ".telemetry").c_str()) != 0)
+	{
+		file.Close();
+		return -1;
+	}
+
+	frameCount = 0;
+	openTime = MicrosecondsNow();
+	indexBuffer.clear();
+	indexBuffer.reserve(index_buffer_entries);
+	spillPath = std::string(path) + ".index";
+	transitionsPath = std::string(path) + ".transitions";
+	transitions.Clear();
+	failed = false;
+
+	RecordingFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.Magic, CLAMIR_RECORDING_MAGIC, sizeof(header.Magic));
+	header.Version = CLAMIR_RECORDING_VERSION;
+	header.HeaderBytes = sizeof(RecordingFileHeader);
+	header.ImageWidth = CLAMIR_IMAGE_WIDTH;
+	header.ImageHeight = CLAMIR_IMAGE_HEIGHT;
+	return Write(&header, sizeof(header));
+}
+
+int FrameRecorder::Write(const void* data, size_t length)
+{
+	if (file.Write(data, length))
+		return 0;
+	failed = true;
+	return -1;
+}
+
+int FrameRecorder::FlushIndex()
+{
+	if (indexBuffer.empty())
+		return 0;
+	if (!spill.IsOpen() && !spill.Create(spillPath.c_str(), spill_grow_bytes, index_view_bytes))
+		return -1;
+	if (!spill.Write(indexBuffer.data(), indexBuffer.size() * sizeof(uint64_t)))
+		return -1;
+	indexBuffer.clear();
+	return 0;
+}
+
+int FrameRecorder::AppendRecord(const int* rawHeader, const void* payload, uint32_t payloadBytes, uint32_t format)
+{
+	if (!file.IsOpen())
+		return -2;
+	if (failed)
+		return -1;
+
+	RecordHeader record;
+	record.PayloadBytes = payloadBytes;
+	record.Format = format;
+	memcpy(record.RawHeader, rawHeader, CLAMIR_RAW_HEADER_BYTES);
+
+	uint64_t offset = file.Offset();
+	static const char padding[4] = { 0, 0, 0, 0 };
+	if (Write(&record, sizeof(record)) != 0 || Write(payload, payloadBytes) != 0 || Write(padding, (size_t)(PaddedPayload(payloadBytes) - payloadBytes)) != 0)
+		return -1;
+
+	if (indexBuffer.size() == index_buffer_entries && FlushIndex() != 0)
+	{
+		failed = true;
+		return -1;
+	}
+	indexBuffer.push_back(offset);
+	frameCount++;
+	return 0;
+}
+
+int FrameRecorder::Append(const int* rawHeader, const int16_t* aImage)
+{
+	if (!file.IsOpen())
+		return -2;
+	TraceScope trace(TRACE_RECORDING);
+	ImageHeader header;
+	DecodeRawHeader(rawHeader, &header);
+	trace.SetFrame(header.FrameNum);
+	if (telemetry.Append(header) != 0)
+	{
+		failed = true;
+		return -1;
+	}
+	transitions.Add(header.TrackNum, header.StateMachine);
+
+	if (compress)
+	{
+		uint8_t encoded[CLAMIR_CODEC_MAX_BYTES];
+		size_t encodedBytes = FrameCodec::Encode(aImage, encoded);
+		if (encodedBytes < raw_payload_bytes)
+			return AppendRecord(rawHeader, encoded, (uint32_t)encodedBytes, CLAMIR_RECORD_DELTA_PACKED);
+	}
+	return AppendRecord(rawHeader, aImage, (uint32_t)raw_payload_bytes, CLAMIR_RECORD_RAW);
+}
+
+int FrameRecorder::Append(const ImageHeader& header, const int16_t* aImage)
+{
+	int rawHeader[CLAMIR_RAW_HEADER_INTS];
+	EncodeRawHeader(header, (uint64_t)(MicrosecondsNow() - openTime), rawHeader);
+	return Append(rawHeader, aImage);
+}
+
+int FrameRecorder::Close()
+{
+	if (!file.IsOpen())
+		return -2;
+
+	int result = failed ? -1 : 0;
+	if (result == 0)
+	{
+		uint64_t padding = 0;
+		result = Write(&padding, (size_t)((8 - file.Offset() % 8) % 8));
+	}
+
+	// Index: spilled entries first, then the ones still in memory
+	uint64_t indexOffset = file.Offset();
+	bool spilled = spill.IsOpen();
+	if (spilled)
+	{
+		uint64_t spilledBytes = spill.Offset();
+		// Trims the preallocation, so the entries can be mapped back up to the end of the file
+		if (!spill.Close() && result == 0)
+			result = -1;
+		MappedFile spilledIndex;
+		if (result == 0 && !spilledIndex.Open(spillPath.c_str()))
+			result = -1;
+		for (uint64_t offset = 0; result == 0 && offset < spilledBytes; offset += index_view_bytes)
+		{
+			size_t length = (size_t)(spilledBytes - offset < index_view_bytes ? spilledBytes - offset : index_view_bytes);
+			const char* entries = spilledIndex.View(offset, length, index_view_bytes);
+			result = entries ? Write(entries, length) : -1;
+		}
+	}
+	if (result == 0 && !indexBuffer.empty())
+		result = Write(indexBuffer.data(), indexBuffer.size() * sizeof(uint64_t));
+
+	if (result == 0)
+	{
+		RecordingFooter footer;
+		memset(&footer, 0, sizeof(footer));
+		memcpy(footer.Magic, CLAMIR_RECORDING_FOOTER_MAGIC, sizeof(footer.Magic));
+		footer.FrameCount = frameCount;
+		footer.IndexOffset = indexOffset;
+		footer.Version = CLAMIR_RECORDING_VERSION;
+		result = Write(&footer, sizeof(footer));
+	}
+
+	// Trims the preallocation
+	if (!file.Close() && result == 0)
+		result = -1;
+
+	if (telemetry.Close() != 0 && result == 0)
+		result = -1;
+	if (transitions.Save(transitionsPath.c_str()) != 0 && result == 0)
+		result = -1;
+
+	if (spilled)
+		remove(spillPath.c_str());
+	indexBuffer.clear();
+	return result;
+}
+
+FrameRecording::FrameRecording() : dataSize(0), indexOffset(0), indexed(false), frameCount(0)
+{
+}
+
+FrameRecording::~FrameRecording()
+{
+	Close();
+}
+
+int FrameRecording::Open(const char* path)
+{
+	Close();
+	if (!file.Open(path))
+		return -1;
+	dataSize = file.Size();
+	if (dataSize < sizeof(RecordingFileHeader))
+	{
+		Close();
+		return -2;
+	}
+	const char* start = file.View(0, sizeof(RecordingFileHeader), (size_t)view_bytes);
+	if (!start)
+	{
+		Close();
+		return -1;
+	}
+
+	RecordingFileHeader header;
+	memcpy(&header, start, sizeof(header));
+	if (memcmp(header.Magic, CLAMIR_RECORDING_MAGIC, sizeof(header.Magic)) != 0 || header.Version > CLAMIR_RECORDING_VERSION)
+	{
+		Close();
+		return -2;
+	}
+
+	if (dataSize >= sizeof(RecordingFileHeader) + sizeof(RecordingFooter))
+	{
+		const char* end = file.View(dataSize - sizeof(RecordingFooter), sizeof(RecordingFooter), sizeof(RecordingFooter));
+		if (!end)
+		{
+			Close();
+			return -1;
+		}
+		RecordingFooter footer;
+		memcpy(&footer, end, sizeof(footer));
+		if (memcmp(footer.Magic, CLAMIR_RECORDING_FOOTER_MAGIC, sizeof(footer.Magic)) == 0 && footer.FrameCount <= dataSize / sizeof(uint64_t) &&
+			footer.IndexOffset + footer.FrameCount * sizeof(uint64_t) <= dataSize - sizeof(RecordingFooter))
+		{
+			if (!indexFile.Open(path))
+			{
+				Close();
+				return -1;
+			}
+			indexOffset = footer.IndexOffset;
+			indexed = true;
+			frameCount = footer.FrameCount;
+			return 0;
+		}
+	}
+
+	// No footer: the recorder did not close the file. Recover the frames written so far
+	if (!ScanRecords(header.HeaderBytes))
+	{
+		Close();
+		return -1;
+	}
+	return 0;
+}
+
+bool FrameRecording::ScanRecords(uint64_t offset)
+{
+	scannedIndex.clear();
+	while (offset + sizeof(RecordHeader) <= dataSize)
+	{
+		const RecordHeader* record = (const RecordHeader*)file.View(offset, sizeof(RecordHeader), (size_t)view_bytes);
+		if (!record)
+			return false;
+		uint64_t next = offset + sizeof(RecordHeader) + PaddedPayload(record->PayloadBytes);
+		// Preallocated space is zero filled, so an empty payload marks the end of the written records
+		if (record->PayloadBytes == 0 || next > dataSize)
+			break;
+		scannedIndex.push_back(offset);
+		offset = next;
+	}
+	frameCount = scannedIndex.size();
+	return true;
+}
+
+void FrameRecording::Close()
+{
+	file.Close();
+	indexFile.Close();
+	dataSize = 0;
+	indexOffset = 0;
+	indexed = false;
+	scannedIndex.clear();
+	frameCount = 0;
+}
+
+bool FrameRecording::RecordOffset(uint64_t i, uint64_t* offset) const
+{
+	if (!indexed)
+	{
+		*offset = scannedIndex[(size_t)i];
+		return true;
+	}
+	const char* entry = indexFile.View(indexOffset + i * sizeof(uint64_t), sizeof(uint64_t), index_view_bytes);
+	if (!entry)
+		return false;
+	memcpy(offset, entry, sizeof(uint64_t));
+	return true;
+}
+
+const RecordHeader* FrameRecording::Record(uint64_t i) const
+{
+	uint64_t offset;
+	if (i >= frameCount || !RecordOffset(i, &offset) || offset > dataSize || dataSize - offset < sizeof(RecordHeader))
+		return 0;
+	const RecordHeader* record = (const RecordHeader*)file.View(offset, sizeof(RecordHeader), (size_t)view_bytes);
+	if (!record || record->PayloadBytes > dataSize - offset - sizeof(RecordHeader))
+		return 0;
+	// Moves the view if the payload crosses its end
+	return (const RecordHeader*)file.View(offset, sizeof(RecordHeader) + record->PayloadBytes, (size_t)view_bytes);
+}
+
+int FrameRecording::ReadFrame(uint64_t i, int* rawHeader, int16_t* aImage) const
+{
+	if (i >= frameCount)
+		return -1;
+	TraceScope trace(TRACE_DECODE);
+	const RecordHeader* record = Record(i);
+	if (!record)
+		return -2;
+	memcpy(rawHeader, record->RawHeader, CLAMIR_RAW_HEADER_BYTES);
+	trace.SetFrame(rawHeader[RAW_FRAME_NUM]);
+
+	const char* payload = (const char*)(record + 1);
+	if (record->Format == CLAMIR_RECORD_RAW && record->PayloadBytes == raw_payload_bytes)
+	{
+		memcpy(aImage, payload, raw_payload_bytes);
+		return 0;
+	}
+	if (record->Format == CLAMIR_RECORD_DELTA_PACKED && FrameCodec::Decode((const uint8_t*)payload, record->PayloadBytes, aImage))
+		return 0;
+	return -2;
+}
+
+int FrameRecording::ReadFrame(uint64_t i, ImageHeader* aImageHeader, int16_t* aImage) const
+{
+	int rawHeader[CLAMIR_RAW_HEADER_INTS];
+	int result = ReadFrame(i, rawHeader, aImage);
+	if (result == 0)
+		DecodeRawHeader(rawHeader, aImageHeader);
+	return result;
+}
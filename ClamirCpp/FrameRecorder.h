@@ -0,0 +1,176 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "ClamirFrame.h"
+#include "MappedFile.h"
+#include "TelemetryStore.h"
+#include "TransitionIndex.h"
+#include "ClamirExport.h"
+
+/**
+*Capture file layout, all integers little endian:
+*- RecordingFileHeader (64 bytes)
+*- One record per frame: a RecordHeader holding the 60 byte raw header, followed by its payload padded to 4 bytes
+*- The frame index: one uint64_t file offset per record
+*- RecordingFooter (32 bytes), which locates the index
+*A capture whose footer is missing, for example after a crash, can still be read by scanning its records.
+*The header fields of every frame are also written to a TelemetryStore file next to the capture, named capture path + ".telemetry", and its TransitionIndex to capture path + ".transitions".
+*/
+#define CLAMIR_RECORDING_MAGIC "CLMRREC1"
+#define CLAMIR_RECORDING_FOOTER_MAGIC "CLMRIDX1"
+#define CLAMIR_RECORDING_VERSION 1
+
+// Payload of a record: 4096 raw int16_t pixels
+#define CLAMIR_RECORD_RAW 0
+// Payload of a record: the image encoded by FrameCodec
+#define CLAMIR_RECORD_DELTA_PACKED 1
+
+struct RecordingFileHeader
+{
+	char Magic[8];
+	uint32_t Version, HeaderBytes, ImageWidth, ImageHeight;
+	uint8_t Reserved[40];
+};
+
+struct RecordHeader
+{
+	uint32_t PayloadBytes, Format;
+	int32_t RawHeader[CLAMIR_RAW_HEADER_INTS];
+};
+
+struct RecordingFooter
+{
+	char Magic[8];
+	uint64_t FrameCount, IndexOffset;
+	uint32_t Version, Reserved;
+};
+
+/**
+@class FrameRecorder
+@brief Append-only, memory-mapped capture writer
+
+*The file is preallocated in large steps and written through a sliding mapped view, so Append is a memory copy that never waits on a write call. The OS writes pages back in the background.
+*Frame offsets are kept in a fixed buffer and spilled to a side file when it fills, so memory use stays bounded on multi-hour recordings. The side file is written through its own MappedWriter, so a spill is a memory copy as well. Close writes the index and the footer and trims the preallocation.
+*/
+class CLAMIRLIBRARY_API FrameRecorder
+{
+public:
+	FrameRecorder();
+	~FrameRecorder();
+
+	FrameRecorder(const FrameRecorder&) = delete;
+	FrameRecorder& operator=(const FrameRecorder&) = delete;
+
+	/**
+	@brief Creates a capture file
+	@param path Path of the capture. The telemetry and the transition index are written to path + ".telemetry" and path + ".transitions", and the index spill file is path + ".index" while recording
+	@param preallocateBytes Size by which the file is grown each time it fills up
+	@returns 0 on success
+	@returns -1 if the file cannot be created or mapped
+	*/
+	int Open(const char* path, uint64_t preallocateBytes = 256ull << 20);
+
+	/**
+	@brief Appends a frame as returned by GetImageRawHeader
+	@returns 0 on success
+	@returns -1 on a file error
+	@returns -2 if the recorder is not open
+	*/
+	int Append(const int* rawHeader, const int16_t* aImage);
+
+	/**
+	@brief Appends a frame as returned by GetImage. The raw header is rebuilt with the layout of RawHeader.h, stamped with the time since Open
+	*/
+	int Append(const ImageHeader& header, const int16_t* aImage);
+
+	/**
+	@brief Enables FrameCodec compression of the frames appended from now on. Frames that do not get smaller are still stored raw
+	*/
+	void SetCompression(bool enable) { compress = enable; }
+	bool Compression() const { return compress; }
+
+	/**
+	@brief Writes the index and the footer and closes the file
+	@returns 0 on success
+	@returns -1 on a file error
+	@returns -2 if the recorder is not open
+	*/
+	int Close();
+
+	bool IsOpen() const { return file.IsOpen(); }
+	uint64_t FrameCount() const { return frameCount; }
+	uint64_t BytesWritten() const { return file.Offset(); }
+
+private:
+	int Write(const void* data, size_t length);
+	int AppendRecord(const int* rawHeader, const void* payload, uint32_t payloadBytes, uint32_t format);
+	int FlushIndex();
+
+	MappedWriter file;
+	uint64_t frameCount;
+	long long openTime;
+
+	std::vector<uint64_t> indexBuffer;
+	std::string spillPath;
+	MappedWriter spill;
+	bool failed;
+	bool compress;
+	TelemetryWriter telemetry;
+	TransitionIndex transitions;
+	std::string transitionsPath;
+};
+
+/**
+@class FrameRecording
+@brief Random access reader for captures written by FrameRecorder
+
+*Records and the index are read through sliding mapped views, so captures of any length open in 32 bit processes too, and the index is used in place, so opening is immediate.
+*/
+class CLAMIRLIBRARY_API FrameRecording
+{
+public:
+	FrameRecording();
+	~FrameRecording();
+
+	FrameRecording(const FrameRecording&) = delete;
+	FrameRecording& operator=(const FrameRecording&) = delete;
+
+	/**
+	@returns 0 on success
+	@returns -1 if the file cannot be opened or mapped
+	@returns -2 if the file is not a capture
+	*/
+	int Open(const char* path);
+	void Close();
+
+	uint64_t FrameCount() const { return frameCount; }
+
+	/**
+	@brief Returns the record of frame i, or a null pointer if i is out of range. Its payload follows the header
+	*The pointer is valid until the next call to Record or ReadFrame.
+	*/
+	const RecordHeader* Record(uint64_t i) const;
+
+	/**
+	@brief Reads frame i
+	@returns 0 on success
+	@returns -1 if i is out of range
+	@returns -2 if the record is corrupt or its format is not supported
+	*/
+	int ReadFrame(uint64_t i, int* rawHeader, int16_t* aImage) const;
+	int ReadFrame(uint64_t i, ImageHeader* aImageHeader, int16_t* aImage) const;
+
+private:
+	bool ScanRecords(uint64_t offset);
+	bool RecordOffset(uint64_t i, uint64_t* offset) const;
+
+	// Records and index entries are read through separate views, so that alternating between them does not remap
+	mutable MappedFile file;
+	mutable MappedFile indexFile;
+	uint64_t dataSize;
+	uint64_t indexOffset;
+	bool indexed;
+	std::vector<uint64_t> scannedIndex;
+	uint64_t frameCount;
+};
@@ -0,0 +1,155 @@
+#include "pch.h"
+#include <string.h>
+#include "FrameStats.h"
+#include "FrameTrace.h"
+
+#ifdef CLAMIR_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// Histogram binning without a division: floor(a * bins / range) == (a * multiplier) >> 32 for every a < range < 65536. The highest value goes to the last bin
+	struct Binning
+	{
+		int Low;
+		uint32_t Range;
+		uint64_t Multiplier;
+		int LastBin;
+	};
+
+	inline void CountPixel(const Binning& binning, int value, uint32_t* histogram)
+	{
+		uint32_t offset = (uint32_t)(value - binning.Low);
+		if (offset > binning.Range)
+			return;
+		histogram[offset == binning.Range ? binning.LastBin : (int)(offset * binning.Multiplier >> 32)]++;
+	}
+
+#if defined(CLAMIR_SSE2)
+	inline int HorizontalSum16(__m128i value)
+	{
+		value = _mm_madd_epi16(value, _mm_set1_epi16(1));
+		value = _mm_add_epi32(value, _mm_srli_si128(value, 8));
+		value = _mm_add_epi32(value, _mm_srli_si128(value, 4));
+		return _mm_cvtsi128_si32(value);
+	}
+#endif
+}
+
+void FrameStats::Compute(const int16_t* aImage, int16_t threshold, int histogramLow, int histogramHigh, int bins, FrameStatistics* stats)
+{
+	TraceScope trace(TRACE_ANALYTICS);
+	if (histogramLow > histogramHigh)
+	{
+		int swap = histogramLow;
+		histogramLow = histogramHigh;
+		histogramHigh = swap;
+	}
+	histogramLow = histogramLow < INT16_MIN ? INT16_MIN : histogramLow > INT16_MAX ? INT16_MAX : histogramLow;
+	histogramHigh = histogramHigh < INT16_MIN ? INT16_MIN : histogramHigh > INT16_MAX ? INT16_MAX : histogramHigh;
+	if (bins < 1)
+		bins = 1;
+	if (bins > CLAMIR_HISTOGRAM_MAX_BINS)
+		bins = CLAMIR_HISTOGRAM_MAX_BINS;
+
+	Binning binning;
+	binning.Low = histogramLow;
+	binning.Range = (uint32_t)(histogramHigh - histogramLow);
+	binning.Multiplier = binning.Range ? ((uint64_t)bins << 32) / binning.Range + 1 : 0;
+	binning.LastBin = bins - 1;
+
+	// Four interleaved histograms so that runs of equal pixels do not serialize on the same counter
+	uint32_t histograms[4][CLAMIR_HISTOGRAM_MAX_BINS];
+	memset(histograms, 0, sizeof(histograms));
+
+	int minimum = INT16_MAX, maximum = INT16_MIN;
+	int64_t sum = 0;
+	uint64_t squares = 0;
+	int area = 0;
+	int64_t sumX = 0, sumY = 0;
+
+	for (int y = 0; y < CLAMIR_IMAGE_HEIGHT; y++)
+	{
+		const int16_t* row = aImage + y * CLAMIR_IMAGE_WIDTH;
+		int rowArea = 0, rowSumX = 0;
+
+#if defined(CLAMIR_SSE2)
+		const __m128i limit = _mm_set1_epi16(threshold);
+		const __m128i zero = _mm_setzero_si128();
+		__m128i low = _mm_set1_epi16(INT16_MAX), high = _mm_set1_epi16(INT16_MIN);
+		__m128i rowSum = zero, rowSquares = zero, rowCount = zero, rowX = zero;
+		__m128i columns = _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+		for (int x = 0; x < CLAMIR_IMAGE_WIDTH; x += 8)
+		{
+			__m128i pixels = _mm_loadu_si128((const __m128i*)(row + x));
+			low = _mm_min_epi16(low, pixels);
+			high = _mm_max_epi16(high, pixels);
+			rowSum = _mm_add_epi32(rowSum, _mm_madd_epi16(pixels, _mm_set1_epi16(1)));
+			// A pair of squares reaches 2^31, so it is read as unsigned and widened before it is added
+			__m128i pairs = _mm_madd_epi16(pixels, pixels);
+			rowSquares = _mm_add_epi64(rowSquares, _mm_add_epi64(_mm_unpacklo_epi32(pairs, zero), _mm_unpackhi_epi32(pairs, zero)));
+			__m128i above = _mm_cmpgt_epi16(pixels, limit);
+			rowCount = _mm_sub_epi16(rowCount, above);
+			rowX = _mm_add_epi16(rowX, _mm_and_si128(above, columns));
+			columns = _mm_add_epi16(columns, _mm_set1_epi16(8));
+		}
+		low = _mm_min_epi16(low, _mm_srli_si128(low, 8));
+		low = _mm_min_epi16(low, _mm_srli_si128(low, 4));
+		low = _mm_min_epi16(low, _mm_srli_si128(low, 2));
+		high = _mm_max_epi16(high, _mm_srli_si128(high, 8));
+		high = _mm_max_epi16(high, _mm_srli_si128(high, 4));
+		high = _mm_max_epi16(high, _mm_srli_si128(high, 2));
+		int rowMin = (int16_t)_mm_extract_epi16(low, 0), rowMax = (int16_t)_mm_extract_epi16(high, 0);
+		minimum = rowMin < minimum ? rowMin : minimum;
+		maximum = rowMax > maximum ? rowMax : maximum;
+		rowSum = _mm_add_epi32(rowSum, _mm_srli_si128(rowSum, 8));
+		rowSum = _mm_add_epi32(rowSum, _mm_srli_si128(rowSum, 4));
+		sum += _mm_cvtsi128_si32(rowSum);
+		rowSquares = _mm_add_epi64(rowSquares, _mm_srli_si128(rowSquares, 8));
+		uint64_t rowSquareSum;
+		_mm_storel_epi64((__m128i*)&rowSquareSum, rowSquares);
+		squares += rowSquareSum;
+		rowArea = HorizontalSum16(rowCount);
+		rowSumX = HorizontalSum16(rowX);
+#else
+		for (int x = 0; x < CLAMIR_IMAGE_WIDTH; x++)
+		{
+			int value = row[x];
+			minimum = value < minimum ? value : minimum;
+			maximum = value > maximum ? value : maximum;
+			sum += value;
+			squares += (uint64_t)(value * value);
+			if (value > threshold)
+			{
+				rowArea++;
+				rowSumX += x;
+			}
+		}
+#endif
+		area += rowArea;
+		sumX += rowSumX;
+		sumY += (int64_t)y * rowArea;
+
+		for (int x = 0; x < CLAMIR_IMAGE_WIDTH; x += 4)
+		{
+			CountPixel(binning, row[x], histograms[0]);
+			CountPixel(binning, row[x + 1], histograms[1]);
+			CountPixel(binning, row[x + 2], histograms[2]);
+			CountPixel(binning, row[x + 3], histograms[3]);
+		}
+	}
+
+	stats->Min = minimum;
+	stats->Max = maximum;
+	stats->Mean = (double)sum / CLAMIR_IMAGE_PIXELS;
+	stats->Variance = ((double)squares - (double)sum * sum / CLAMIR_IMAGE_PIXELS) / (CLAMIR_IMAGE_PIXELS - 1);
+	stats->Area = area;
+	stats->CentroidX = area ? (float)((double)sumX / area) : -1.0f;
+	stats->CentroidY = area ? (float)((double)sumY / area) : -1.0f;
+	stats->HistogramLow = histogramLow;
+	stats->HistogramHigh = histogramHigh;
+	stats->Bins = bins;
+	for (int b = 0; b < bins; b++)
+		stats->Histogram[b] = histograms[0][b] + histograms[1][b] + histograms[2][b] + histograms[3][b];
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "ClamirFrame.h"
+#include "ClamirExport.h"
+
+#define CLAMIR_HISTOGRAM_MAX_BINS 256
+
+/**
+@brief Statistics of one frame, filled by FrameStats::Compute
+*/
+struct FrameStatistics
+{
+	int Min, Max;
+	// Mean and sample variance of all pixels, as CImg<T>::get_stats computes them
+	double Mean, Variance;
+	// Pixels strictly above the threshold and their mean position, -1 when there are none
+	int Area;
+	float CentroidX, CentroidY;
+	// Histogram of the pixels in [HistogramLow, HistogramHigh], binned as CImg<T>::get_histogram
+	int HistogramLow, HistogramHigh, Bins;
+	uint32_t Histogram[CLAMIR_HISTOGRAM_MAX_BINS];
+};
+
+/**
+@class FrameStats
+@brief Fused single pass statistics over the 4096 pixels of a frame
+
+*Min, max, sums, thresholded area and centroid are computed with SSE2 and the histogram is filled from the same row while it is in L1, so the frame is streamed once instead of once per CImg call.
+*/
+class CLAMIRLIBRARY_API FrameStats
+{
+public:
+	/**
+	@brief Computes the statistics of a frame
+	@param aImage Pointer to an array of 4096 int16_t pixels
+	@param threshold Threshold of the area and centroid
+	@param histogramLow Lowest value counted in the histogram, clamped to the int16_t range
+	@param histogramHigh Highest value counted in the histogram, which falls in the last bin, clamped to the int16_t range
+	@param bins Number of histogram bins, 1 to CLAMIR_HISTOGRAM_MAX_BINS
+	@param stats Receives the statistics
+	*/
+	static void Compute(const int16_t* aImage, int16_t threshold, int histogramLow, int histogramHigh, int bins, FrameStatistics* stats);
+};
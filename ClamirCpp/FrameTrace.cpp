@@ -0,0 +1,185 @@
+#include "pch.h"
+#include <atomic>
+#include <new>
+#include <vector>
+#include "FrameTrace.h"
+#include "DeviceCallStats.h"
+
+namespace
+{
+	const uint64_t event_mask = CLAMIR_TRACE_THREAD_EVENTS - 1;
+
+	const char* const stage_names[TRACE_STAGES] = { "acquisition", "decode", "analytics", "recording", "display" };
+
+	struct TraceEvent
+	{
+		uint64_t Timestamp;
+		int32_t Frame;
+		uint16_t Stage, Begin;
+	};
+
+	// Written only by its thread. Written counts every event ever recorded; event n is in slot n & event_mask
+	struct ThreadTrace
+	{
+		TraceEvent Events[CLAMIR_TRACE_THREAD_EVENTS];
+		std::atomic<uint64_t> Written;
+		std::atomic<const char*> Name;
+		uint32_t Thread;
+		ThreadTrace* Next;
+	};
+
+	std::atomic<bool> tracing(false);
+	// Rings are never freed, so the events of finished threads can still be exported
+	std::atomic<ThreadTrace*> thread_traces(nullptr);
+	std::atomic<uint32_t> thread_count(0);
+	std::atomic<uint64_t> cleared_at(0);
+	thread_local ThreadTrace* local_trace = nullptr;
+	// Name given before the thread recorded anything; its ring takes it when allocated
+	thread_local const char* local_name = nullptr;
+
+	ThreadTrace* Register()
+	{
+		ThreadTrace* trace = new (std::nothrow) ThreadTrace;
+		if (!trace)
+			return nullptr;
+		trace->Written.store(0, std::memory_order_relaxed);
+		trace->Name.store(local_name, std::memory_order_relaxed);
+		trace->Thread = thread_count.fetch_add(1, std::memory_order_relaxed) + 1;
+		ThreadTrace* head = thread_traces.load(std::memory_order_relaxed);
+		do
+			trace->Next = head;
+		while (!thread_traces.compare_exchange_weak(head, trace, std::memory_order_release, std::memory_order_relaxed));
+		local_trace = trace;
+		return trace;
+	}
+
+	inline void Record(int stage, int frame, bool begin)
+	{
+		if (!tracing.load(std::memory_order_relaxed) || stage < 0 || stage >= TRACE_STAGES)
+			return;
+		ThreadTrace* trace = local_trace ? local_trace : Register();
+		if (!trace)
+			return;
+		uint64_t n = trace->Written.load(std::memory_order_relaxed);
+		TraceEvent& event = trace->Events[n & event_mask];
+		event.Timestamp = DeviceCallStats::Now();
+		event.Frame = frame;
+		event.Stage = (uint16_t)stage;
+		event.Begin = begin ? 1 : 0;
+		trace->Written.store(n + 1, std::memory_order_release);
+	}
+
+	// Copies the events of a ring that are newer than since and were not overwritten during the copy
+	void Collect(const ThreadTrace* trace, uint64_t since, std::vector<TraceEvent>* events)
+	{
+		events->clear();
+		uint64_t written = trace->Written.load(std::memory_order_acquire);
+		uint64_t first = written > CLAMIR_TRACE_THREAD_EVENTS ? written - CLAMIR_TRACE_THREAD_EVENTS : 0;
+		for (uint64_t n = first; n < written; n++)
+			events->push_back(trace->Events[n & event_mask]);
+
+		// Orders the copy before the second read. The writer may be storing event after, which overwrites event after - N, so that one is dropped too
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t after = trace->Written.load(std::memory_order_relaxed);
+		uint64_t intact = after + 1 > CLAMIR_TRACE_THREAD_EVENTS ? after + 1 - CLAMIR_TRACE_THREAD_EVENTS : 0;
+		size_t skip = intact > first ? (size_t)(intact - first) : 0;
+		if (skip > events->size())
+			skip = events->size();
+		events->erase(events->begin(), events->begin() + skip);
+		size_t kept = 0;
+		for (size_t i = 0; i < events->size(); i++)
+			if ((*events)[i].Timestamp >= since)
+				(*events)[kept++] = (*events)[i];
+		events->resize(kept);
+	}
+}
+
+void FrameTrace::SetEnabled(bool enabled)
+{
+	tracing.store(enabled, std::memory_order_relaxed);
+}
+
+bool FrameTrace::Enabled()
+{
+	return tracing.load(std::memory_order_relaxed);
+}
+
+void FrameTrace::Begin(int stage, int frame)
+{
+	Record(stage, frame, true);
+}
+
+void FrameTrace::End(int stage, int frame)
+{
+	Record(stage, frame, false);
+}
+
+void FrameTrace::NameThread(const char* name)
+{
+	local_name = name;
+	if (local_trace)
+		local_trace->Name.store(name, std::memory_order_release);
+}
+
+void FrameTrace::Clear()
+{
+	cleared_at.store(DeviceCallStats::Now(), std::memory_order_relaxed);
+}
+
+int FrameTrace::Export(FILE* file)
+{
+	uint64_t since = cleared_at.load(std::memory_order_relaxed);
+	std::vector<std::vector<TraceEvent>> threads;
+	std::vector<const ThreadTrace*> traces;
+	uint64_t origin = UINT64_MAX;
+	for (const ThreadTrace* trace = thread_traces.load(std::memory_order_acquire); trace; trace = trace->Next)
+	{
+		threads.push_back(std::vector<TraceEvent>());
+		traces.push_back(trace);
+		Collect(trace, since, &threads.back());
+		if (!threads.back().empty() && threads.back().front().Timestamp < origin)
+			origin = threads.back().front().Timestamp;
+	}
+
+	bool failed = fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n") < 0;
+	int count = 0;
+	const char* separator = "";
+	for (size_t t = 0; t < traces.size() && !failed; t++)
+	{
+		const char* name = traces[t]->Name.load(std::memory_order_acquire);
+		if (name)
+		{
+			failed = fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"", separator, traces[t]->Thread) < 0;
+			for (const char* c = name; *c && !failed; c++)
+				failed = (*c == '"' || *c == '\\' ? fprintf(file, "\\%c", *c) : fprintf(file, "%c", (unsigned char)*c >= 0x20 ? *c : ' ')) < 0;
+			failed = failed || fprintf(file, "\"}}") < 0;
+			separator = ",\n";
+		}
+		for (size_t i = 0; i < threads[t].size() && !failed; i++)
+		{
+			const TraceEvent& event = threads[t][i];
+			double timestamp = (event.Timestamp - origin) / 1000.0;
+			if (event.Frame >= 0)
+				failed = fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"frame\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"frame\":%d}}",
+					separator, stage_names[event.Stage], event.Begin ? 'B' : 'E', timestamp, traces[t]->Thread, event.Frame) < 0;
+			else
+				failed = fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"frame\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}",
+					separator, stage_names[event.Stage], event.Begin ? 'B' : 'E', timestamp, traces[t]->Thread) < 0;
+			separator = ",\n";
+			count++;
+		}
+	}
+	failed = failed || fprintf(file, "\n]}\n") < 0;
+	return failed ? -1 : count;
+}
+
+int FrameTrace::Export(const char* path)
+{
+	FILE* file = fopen(path, "w");
+	if (!file)
+		return -1;
+	int result = Export(file);
+	if (fclose(file) != 0)
+		result = -1;
+	return result;
+}
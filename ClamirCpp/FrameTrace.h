@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include "ClamirExport.h"
+
+/**
+*Events kept per thread, a power of two. Older events are overwritten, so the trace always holds the last seconds of every thread
+*/
+#define CLAMIR_TRACE_THREAD_EVENTS (1 << 16)
+
+enum TraceStage
+{
+	TRACE_ACQUISITION = 0,
+	TRACE_DECODE,
+	TRACE_ANALYTICS,
+	TRACE_RECORDING,
+	TRACE_DISPLAY,
+	TRACE_STAGES
+};
+
+/**
+@class FrameTrace
+@brief Flight recorder of the frame pipeline stages, exported as Chrome trace JSON for chrome://tracing or Perfetto
+
+*Every thread writes its begin and end events to its own ring, allocated on its first event, so recording takes no lock and shares no cache line: a relaxed load of the enabled flag, a clock read and a 16 byte store.
+*Events carry the frame number when the stage knows it, so one frame can be followed from acquisition to display.
+*Disabled by default; when disabled Begin and End return after the flag check.
+*/
+class CLAMIRLIBRARY_API FrameTrace
+{
+public:
+	static void SetEnabled(bool enabled);
+	static bool Enabled();
+
+	/**
+	@param stage One of the TraceStage values
+	@param frame Frame number, or -1 if unknown. The frames of Begin and End are merged by the viewers
+	*/
+	static void Begin(int stage, int frame = -1);
+	static void End(int stage, int frame = -1);
+
+	/**
+	@brief Names the calling thread in the exported trace
+	*Allocates nothing: a thread that never records while tracing is enabled gets no ring.
+	@param name Must outlive the trace, e.g. a string literal
+	*/
+	static void NameThread(const char* name);
+
+	/**
+	@brief Drops the events recorded so far from the exports. Does not touch the rings, so it can be called while threads record
+	*/
+	static void Clear();
+
+	/**
+	@brief Writes the events of every thread as Chrome trace JSON
+	*Threads may keep recording meanwhile; events overwritten while the export copies their ring are left out.
+	@returns The number of events written
+	@returns -1 on a write error
+	*/
+	static int Export(FILE* file);
+
+	/**
+	@brief Exports to a file, replacing it
+	@returns The number of events written
+	@returns -1 if the file cannot be written
+	*/
+	static int Export(const char* path);
+};
+
+/**
+@class TraceScope
+@brief Records a stage for the lifetime of the object
+*/
+class TraceScope
+{
+public:
+	explicit TraceScope(int stage, int frame = -1) : stage(stage), frame(frame)
+	{
+		FrameTrace::Begin(stage, frame);
+	}
+
+	~TraceScope()
+	{
+		FrameTrace::End(stage, frame);
+	}
+
+	TraceScope(const TraceScope&) = delete;
+	TraceScope& operator=(const TraceScope&) = delete;
+
+	/**
+	@brief Sets the frame of the end event, for stages that learn it on the way, such as acquisition
+	*/
+	void SetFrame(int value) { frame = value; }
+
+private:
+	int stage, frame;
+};
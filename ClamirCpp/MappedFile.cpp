@@ -0,0 +1,306 @@
+#include "pch.h"
+#include <string.h>
+#include "MappedFile.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile() : file(INVALID_HANDLE_VALUE), mapping(0), writable(false), size(0), view(0), viewStart(0), viewLength(0)
+{
+}
+
+bool MappedFile::Create(const char* path)
+{
+	Close();
+	file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+	writable = true;
+	size = 0;
+	return file != INVALID_HANDLE_VALUE;
+}
+
+bool MappedFile::Open(const char* path)
+{
+	Close();
+	file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize))
+	{
+		Close();
+		return false;
+	}
+	writable = false;
+	size = (uint64_t)fileSize.QuadPart;
+	mapping = size ? CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0) : 0;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	Unmap();
+	if (mapping)
+	{
+		CloseHandle(mapping);
+		mapping = 0;
+	}
+	if (file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(file);
+		file = INVALID_HANDLE_VALUE;
+	}
+	size = 0;
+}
+
+bool MappedFile::IsOpen() const
+{
+	return file != INVALID_HANDLE_VALUE;
+}
+
+bool MappedFile::Resize(uint64_t newSize)
+{
+	Unmap();
+	if (mapping)
+	{
+		CloseHandle(mapping);
+		mapping = 0;
+	}
+	LARGE_INTEGER position;
+	position.QuadPart = (LONGLONG)newSize;
+	if (!SetFilePointerEx(file, position, 0, FILE_BEGIN) || !SetEndOfFile(file))
+		return false;
+	size = newSize;
+	if (size)
+	{
+		mapping = CreateFileMappingA(file, 0, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)size, 0);
+		if (!mapping)
+			return false;
+	}
+	return true;
+}
+
+char* MappedFile::Map(uint64_t offset, size_t length)
+{
+	Unmap();
+	if (!mapping || offset + length > size || length == 0)
+		return 0;
+	uint64_t aligned = offset - offset % Granularity();
+	viewLength = (size_t)(offset - aligned) + length;
+	view = (char*)MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, (DWORD)(aligned >> 32), (DWORD)aligned, viewLength);
+	if (!view)
+	{
+		viewLength = 0;
+		return 0;
+	}
+	viewStart = aligned;
+	return view + (offset - aligned);
+}
+
+void MappedFile::Unmap()
+{
+	if (view)
+	{
+		UnmapViewOfFile(view);
+		view = 0;
+		viewLength = 0;
+	}
+}
+
+size_t MappedFile::Granularity()
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwAllocationGranularity;
+}
+
+#else
+
+MappedFile::MappedFile() : file(-1), writable(false), size(0), view(0), viewStart(0), viewLength(0)
+{
+}
+
+bool MappedFile::Create(const char* path)
+{
+	Close();
+	file = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	writable = true;
+	size = 0;
+	return file >= 0;
+}
+
+bool MappedFile::Open(const char* path)
+{
+	Close();
+	file = open(path, O_RDONLY);
+	if (file < 0)
+		return false;
+	struct stat info;
+	if (fstat(file, &info) != 0)
+	{
+		Close();
+		return false;
+	}
+	writable = false;
+	size = (uint64_t)info.st_size;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	Unmap();
+	if (file >= 0)
+	{
+		close(file);
+		file = -1;
+	}
+	size = 0;
+}
+
+bool MappedFile::IsOpen() const
+{
+	return file >= 0;
+}
+
+bool MappedFile::Resize(uint64_t newSize)
+{
+	Unmap();
+	// ftruncate alone would leave a sparse file, and a full disk would then raise SIGBUS on the first write to an unbacked page.
+	// A failed reservation may leave the file partly extended; size keeps the old value and the next Resize trims it
+	if (newSize > size)
+	{
+		if (posix_fallocate(file, (off_t)size, (off_t)(newSize - size)) != 0)
+			return false;
+	}
+	else if (ftruncate(file, (off_t)newSize) != 0)
+		return false;
+	size = newSize;
+	return true;
+}
+
+char* MappedFile::Map(uint64_t offset, size_t length)
+{
+	Unmap();
+	if (offset + length > size || length == 0)
+		return 0;
+	uint64_t aligned = offset - offset % Granularity();
+	viewLength = (size_t)(offset - aligned) + length;
+	void* mapped = mmap(0, viewLength, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, file, (off_t)aligned);
+	if (mapped == MAP_FAILED)
+	{
+		viewLength = 0;
+		return 0;
+	}
+	view = (char*)mapped;
+	viewStart = aligned;
+	return view + (offset - aligned);
+}
+
+void MappedFile::Unmap()
+{
+	if (view)
+	{
+		munmap(view, viewLength);
+		view = 0;
+		viewLength = 0;
+	}
+}
+
+size_t MappedFile::Granularity()
+{
+	return (size_t)sysconf(_SC_PAGESIZE);
+}
+
+#endif
+
+char* MappedFile::View(uint64_t offset, size_t length, size_t window)
+{
+	if (view && offset >= viewStart && offset - viewStart <= viewLength && length <= viewLength - (offset - viewStart))
+		return view + (offset - viewStart);
+	if (offset > size || length > size - offset)
+		return 0;
+	uint64_t span = window > length ? window : length;
+	if (span > size - offset)
+		span = size - offset;
+	return Map(offset, (size_t)span);
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+MappedWriter::MappedWriter() : growBytes(0), viewBytes(0), writeOffset(0), view(0), viewOffset(0), viewEnd(0), failed(false)
+{
+}
+
+bool MappedWriter::Create(const char* path, uint64_t grow, uint64_t viewSize)
+{
+	uint64_t granularity = MappedFile::Granularity();
+	viewBytes = (viewSize + granularity - 1) / granularity * granularity;
+	growBytes = grow < viewBytes ? viewBytes : (grow + viewBytes - 1) / viewBytes * viewBytes;
+	writeOffset = 0;
+	view = 0;
+	viewOffset = viewEnd = 0;
+	failed = false;
+	if (!file.Create(path))
+		return false;
+	if (!file.Resize(growBytes))
+	{
+		file.Close();
+		return false;
+	}
+	return true;
+}
+
+bool MappedWriter::Write(const void* data, size_t length)
+{
+	if (failed || !file.IsOpen())
+		return false;
+	const char* source = (const char*)data;
+	while (length > 0)
+	{
+		if (writeOffset >= viewEnd)
+		{
+			// Slide the view to the write position, growing the file first if it is full
+			if (writeOffset + viewBytes > file.Size() && !file.Resize(file.Size() + growBytes))
+			{
+				failed = true;
+				return false;
+			}
+			viewOffset = writeOffset - writeOffset % MappedFile::Granularity();
+			view = file.Map(viewOffset, (size_t)viewBytes);
+			if (!view)
+			{
+				viewEnd = 0;
+				failed = true;
+				return false;
+			}
+			viewEnd = viewOffset + viewBytes;
+		}
+
+		size_t chunk = (size_t)(viewEnd - writeOffset < length ? viewEnd - writeOffset : length);
+		memcpy(view + (writeOffset - viewOffset), source, chunk);
+		writeOffset += chunk;
+		source += chunk;
+		length -= chunk;
+	}
+	return true;
+}
+
+bool MappedWriter::Close()
+{
+	if (!file.IsOpen())
+		return false;
+	file.Unmap();
+	view = 0;
+	viewEnd = 0;
+	bool result = file.Resize(writeOffset) && !failed;
+	file.Close();
+	return result;
+}
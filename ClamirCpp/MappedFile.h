@@ -0,0 +1,118 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+@class MappedFile
+@brief Thin wrapper over Win32 file mappings and POSIX mmap
+
+*A file is mapped through one view at a time. Writers grow the file in large steps with Resize and slide the view forward with Map, readers move it with View, so memory and address space use stay bounded whatever the file size.
+*/
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	/**
+	@brief Creates or truncates a file for writing
+	@returns true on success
+	*/
+	bool Create(const char* path);
+
+	/**
+	@brief Opens an existing file read-only
+	@returns true on success
+	*/
+	bool Open(const char* path);
+
+	void Close();
+	bool IsOpen() const;
+
+	uint64_t Size() const { return size; }
+
+	/**
+	@brief Sets the size of a file opened with Create. Unmaps the current view
+	*Growing reserves the disk space, so a full disk is reported here rather than as an access fault on a write through the view.
+	@returns true on success
+	*/
+	bool Resize(uint64_t newSize);
+
+	/**
+	@brief Maps [offset, offset + length) and returns a pointer to offset. Replaces the current view
+	@returns a null pointer on failure or if the range is past the end of the file
+	*/
+	char* Map(uint64_t offset, size_t length);
+	void Unmap();
+
+	/**
+	@brief Returns a pointer to offset, valid for length bytes until the view moves
+	*Keeps the current view when it covers the range; otherwise maps window bytes from offset, or length if larger, clipped to the end of the file.
+	@returns a null pointer on failure or if the range is past the end of the file
+	*/
+	char* View(uint64_t offset, size_t length, size_t window);
+
+	/**
+	@brief Granularity of view offsets. Map aligns its offset down to it internally
+	*/
+	static size_t Granularity();
+
+private:
+#ifdef _WIN32
+	void* file;
+	void* mapping;
+#else
+	int file;
+#endif
+	bool writable;
+	uint64_t size;
+	char* view;
+	uint64_t viewStart;
+	size_t viewLength;
+};
+
+/**
+@class MappedWriter
+@brief Append-only writer over a MappedFile
+
+*The file is grown in large steps and written through a view that slides forward with the write position, so Write is a memory copy; the OS writes pages back in the background.
+*/
+class MappedWriter
+{
+public:
+	MappedWriter();
+
+	/**
+	@brief Creates or truncates a file and reserves its first growBytes
+	@param growBytes Size by which the file is grown each time it fills up, rounded up to viewBytes
+	@param viewBytes Size of the mapped view, rounded up to MappedFile::Granularity
+	@returns true on success
+	*/
+	bool Create(const char* path, uint64_t growBytes, uint64_t viewBytes);
+
+	/**
+	@returns true on success, false on a file error, after which every write fails
+	*/
+	bool Write(const void* data, size_t length);
+
+	/**
+	@brief Trims the preallocation and closes the file
+	@returns true on success
+	*/
+	bool Close();
+
+	bool IsOpen() const { return file.IsOpen(); }
+	uint64_t Offset() const { return writeOffset; }
+
+private:
+	MappedFile file;
+	uint64_t growBytes, viewBytes;
+	uint64_t writeOffset;
+	char* view;
+	uint64_t viewOffset, viewEnd;
+	bool failed;
+};
@@ -0,0 +1,128 @@
+#include "pch.h"
+#include <math.h>
+#include "MeltPoolGeometry.h"
+#include "BitOps.h"
+#include "FrameTrace.h"
+
+namespace
+{
+	const double pi = 3.14159265358979323846;
+
+	// Position between an outside pixel at 0 and an inside pixel at 1 where the image crosses the threshold
+	inline float Crossing(int outside, int inside, int threshold)
+	{
+		return inside > outside ? (float)(threshold - outside) / (float)(inside - outside) : 0.5f;
+	}
+}
+
+MeltPoolGeometry::MeltPoolGeometry() : contourCount(0)
+{
+}
+
+void MeltPoolGeometry::AddContourPoint(float x, float y)
+{
+	contour[contourCount].X = x;
+	contour[contourCount].Y = y;
+	contourCount++;
+}
+
+int MeltPoolGeometry::Measure(const int16_t* aImage, int16_t threshold, float pixelToMillimeter, MeltPoolShape* shape)
+{
+	TraceScope trace(TRACE_ANALYTICS);
+	contourCount = 0;
+	mask.Build(aImage, threshold);
+	if (mask.Empty())
+		return -1;
+	// 8-connectivity, so that the pixels outside every edge are below the threshold
+	labeler.Label(mask, 0, true);
+	labeler.ComponentMask(labeler.Largest(), &pool);
+
+	// Second moments of the melt pool, then the contour at the threshold crossings of its row and column edges
+	int64_t n = 0, sumX = 0, sumY = 0, sumXX = 0, sumYY = 0, sumXY = 0;
+	for (int y = 0; y < CLAMIR_IMAGE_HEIGHT; y++)
+	{
+		uint64_t bits = pool.Rows[y];
+		if (!bits)
+			continue;
+		int rowCount = 0, rowX = 0, rowXX = 0;
+		for (uint64_t rest = bits; rest; rest &= rest - 1)
+		{
+			int x = LowestBit(rest);
+			rowCount++;
+			rowX += x;
+			rowXX += x * x;
+		}
+		n += rowCount;
+		sumX += rowX;
+		sumY += (int64_t)y * rowCount;
+		sumXX += rowXX;
+		sumYY += (int64_t)y * y * rowCount;
+		sumXY += (int64_t)y * rowX;
+
+		const int16_t* row = aImage + y * CLAMIR_IMAGE_WIDTH;
+		int left = LowestBit(bits), right = HighestBit(bits);
+		AddContourPoint(left > 0 ? left - 1 + Crossing(row[left - 1], row[left], threshold) : left - 0.5f, (float)y);
+		AddContourPoint(right < CLAMIR_IMAGE_WIDTH - 1 ? right + 1 - Crossing(row[right + 1], row[right], threshold) : right + 0.5f, (float)y);
+	}
+
+	// Top and bottom edge of every column, found by tracking the columns already seen from each side
+	uint64_t seen = 0;
+	for (int y = 0; y < CLAMIR_IMAGE_HEIGHT; y++)
+	{
+		for (uint64_t first = pool.Rows[y] & ~seen; first; first &= first - 1)
+		{
+			int x = LowestBit(first);
+			float edge = y > 0 ? y - 1 + Crossing(aImage[(y - 1) * CLAMIR_IMAGE_WIDTH + x], aImage[y * CLAMIR_IMAGE_WIDTH + x], threshold) : y - 0.5f;
+			AddContourPoint((float)x, edge);
+		}
+		seen |= pool.Rows[y];
+	}
+	seen = 0;
+	for (int y = CLAMIR_IMAGE_HEIGHT - 1; y >= 0; y--)
+	{
+		for (uint64_t last = pool.Rows[y] & ~seen; last; last &= last - 1)
+		{
+			int x = LowestBit(last);
+			float edge = y < CLAMIR_IMAGE_HEIGHT - 1 ? y + 1 - Crossing(aImage[(y + 1) * CLAMIR_IMAGE_WIDTH + x], aImage[y * CLAMIR_IMAGE_WIDTH + x], threshold) : y + 0.5f;
+			AddContourPoint((float)x, edge);
+		}
+		seen |= pool.Rows[y];
+	}
+
+	double cx = (double)sumX / n, cy = (double)sumY / n;
+	double mu20 = (double)sumXX / n - cx * cx;
+	double mu02 = (double)sumYY / n - cy * cy;
+	double mu11 = (double)sumXY / n - cx * cy;
+	double angle = 0.5 * atan2(2.0 * mu11, mu20 - mu02);
+	double spread = sqrt(4.0 * mu11 * mu11 + (mu20 - mu02) * (mu20 - mu02));
+	double major = 0.5 * (mu20 + mu02 + spread), minor = 0.5 * (mu20 + mu02 - spread);
+
+	// A uniform ellipse of semi-axis a has a variance of a^2 / 4 along that axis
+	shape->MajorAxis = (float)(4.0 * sqrt(major > 0.0 ? major : 0.0));
+	shape->MinorAxis = (float)(4.0 * sqrt(minor > 0.0 ? minor : 0.0));
+
+	double c = cos(angle), s = sin(angle);
+	double minU = 1e9, maxU = -1e9, minV = 1e9, maxV = -1e9;
+	for (int i = 0; i < contourCount; i++)
+	{
+		double dx = contour[i].X - cx, dy = contour[i].Y - cy;
+		double u = dx * c + dy * s, v = dy * c - dx * s;
+		minU = u < minU ? u : minU;
+		maxU = u > maxU ? u : maxU;
+		minV = v < minV ? v : minV;
+		maxV = v > maxV ? v : maxV;
+	}
+
+	shape->Area = (int)n;
+	shape->CentroidX = (float)cx;
+	shape->CentroidY = (float)cy;
+	shape->Length = (float)(maxU - minU);
+	shape->Width = (float)(maxV - minV);
+	shape->LengthMm = shape->Length * pixelToMillimeter;
+	shape->WidthMm = shape->Width * pixelToMillimeter;
+	shape->AspectRatio = shape->Width > 0.0f ? shape->Length / shape->Width : 0.0f;
+	shape->Orientation = (float)(angle * 180.0 / pi);
+	if (shape->Orientation <= -90.0f)
+		shape->Orientation += 180.0f;
+	return 0;
+}
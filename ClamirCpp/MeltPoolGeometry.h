@@ -0,0 +1,71 @@
+#pragma once
+
+#include "ClamirFrame.h"
+#include "ComponentLabeler.h"
+#include "MeltPoolMask.h"
+#include "ClamirExport.h"
+
+// Left and right edge of every row plus top and bottom edge of every column
+#define CLAMIR_MAX_CONTOUR_POINTS (2 * CLAMIR_IMAGE_HEIGHT + 2 * CLAMIR_IMAGE_WIDTH)
+
+struct ContourPoint
+{
+	float X, Y;
+};
+
+/**
+@brief Geometry of the melt pool. Positions are in pixels, with pixel (x, y) centred on (x, y)
+*/
+struct MeltPoolShape
+{
+	int Area;
+	float CentroidX, CentroidY;
+	// Extent of the sub-pixel contour across and along the major axis
+	float Width, Length;
+	float WidthMm, LengthMm;
+	float AspectRatio;
+	// Angle of the major axis from the x axis, in degrees within (-90, 90]
+	float Orientation;
+	// Full axes of the ellipse with the same second moments as the melt pool
+	float MajorAxis, MinorAxis;
+};
+
+/**
+@class MeltPoolGeometry
+@brief Sub-pixel melt pool width, length and orientation
+
+*The melt pool is the largest connected component above the threshold. Its contour is placed where the image crosses the threshold, interpolated linearly between the pixels on either side of every row and column edge.
+*The second moments of the component give its orientation and equivalent ellipse. Width and length are the extents of the contour across and along the major axis, which keeps them sub-pixel even though the moments are computed on whole pixels.
+*All buffers are members of fixed size, so a measurement never allocates. The object is large: keep one per thread.
+*/
+class CLAMIRLIBRARY_API MeltPoolGeometry
+{
+public:
+	MeltPoolGeometry();
+
+	/**
+	@brief Measures the melt pool of a frame
+	@param aImage Pointer to an array of 4096 int16_t pixels
+	@param threshold Threshold in digital counts, as read by ThresholdGet
+	@param pixelToMillimeter Ratio read by PixelToMillimeterRatioGet, used for WidthMm and LengthMm
+	@param shape Receives the measurements
+	@returns 0 on success
+	@returns -1 if no pixel is above the threshold
+	*/
+	int Measure(const int16_t* aImage, int16_t threshold, float pixelToMillimeter, MeltPoolShape* shape);
+
+	/**
+	@brief Contour of the last measured melt pool
+	*/
+	int ContourCount() const { return contourCount; }
+	const ContourPoint& Contour(int i) const { return contour[i]; }
+
+private:
+	void AddContourPoint(float x, float y);
+
+	MeltPoolMask mask;
+	MeltPoolMask pool;
+	ComponentLabeler labeler;
+	ContourPoint contour[CLAMIR_MAX_CONTOUR_POINTS];
+	int contourCount;
+};
@@ -0,0 +1,204 @@
+#include "pch.h"
+#include <string.h>
+#include "MeltPoolMask.h"
+#include "BitOps.h"
+
+#ifdef CLAMIR_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef CLAMIR_AVX2
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	const uint64_t last_column = 1ull << (CLAMIR_IMAGE_WIDTH - 1);
+
+	// Left neighbour of every pixel of a row, the first pixel being its own neighbour
+	inline uint64_t LeftNeighbours(uint64_t row)
+	{
+		return row << 1 | (row & 1);
+	}
+
+	inline uint64_t RightNeighbours(uint64_t row)
+	{
+		return row >> 1 | (row & last_column);
+	}
+
+	void Erode(uint64_t* rows)
+	{
+		uint64_t horizontal[CLAMIR_IMAGE_HEIGHT];
+		for (int y = 0; y < CLAMIR_IMAGE_HEIGHT; y++)
+			horizontal[y] = rows[y] & LeftNeighbours(rows[y]) & RightNeighbours(rows[y]);
+		for (int y = 0; y < CLAMIR_IMAGE_HEIGHT; y++)
+		{
+			uint64_t above = horizontal[y > 0 ? y - 1 : 0];
+			uint64_t below = horizontal[y < CLAMIR_IMAGE_HEIGHT - 1 ? y + 1 : y];
+			rows[y] = above & horizontal[y] & below;
+		}
+	}
+
+	void Dilate(uint64_t* rows)
+	{
+		uint64_t horizontal[CLAMIR_IMAGE_HEIGHT];
+		for (int y = 0; y < CLAMIR_IMAGE_HEIGHT; y++)
+			horizontal[y] = rows[y] | LeftNeighbours(rows[y]) | RightNeighbours(rows[y]);
+		for (int y = 0; y < CLAMIR_IMAGE_HEIGHT; y++)
+		{
+			uint64_t above = horizontal[y > 0 ? y - 1 : 0];
+			uint64_t below = horizontal[y < CLAMIR_IMAGE_HEIGHT - 1 ? y + 1 : y];
+			rows[y] = above | horizontal[y] | below;
+		}
+	}
+}
+
+void MeltPoolMask::Clear()
+{
+	memset(Rows, 0, sizeof(Rows));
+}
+
+void MeltPoolMask::Fill()
+{
+	memset(Rows, 0xFF, sizeof(Rows));
+}
+
+void MeltPoolMask::Build(const int16_t* aImage, int16_t threshold)
+{
+#if defined(CLAMIR_AVX2)
+	const __m256i limit = _mm256_set1_epi16(threshold);
+	for (int y = 0; y < CLAMIR_IMAGE_HEIGHT; y++)
+	{
+		const int16_t* row = aImage + y * CLAMIR_IMAGE_WIDTH;
+		uint64_t bits = 0;
+		for (int x = 0; x < CLAMIR_IMAGE_WIDTH; x += 32)
+		{
+			__m256i first = _mm256_cmpgt_epi16(_mm256_loadu_si256((const __m256i*)(row + x)), limit);
+			__m256i second = _mm256_cmpgt_epi16(_mm256_loadu_si256((const __m256i*)(row + x + 16)), limit);
+			// packs interleaves the 128 bit lanes, the permutation puts the bytes back in pixel order
+			__m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(first, second), 0xD8);
+			bits |= (uint64_t)(uint32_t)_mm256_movemask_epi8(packed) << x;
+		}
+		Rows[y] = bits;
+	}
+#elif defined(CLAMIR_SSE2)
+	const __m128i limit = _mm_set1_epi16(threshold);
+	for (int y = 0; y < CLAMIR_IMAGE_HEIGHT; y++)
+	{
+		const int16_t* row = aImage + y * CLAMIR_IMAGE_WIDTH;
+		uint64_t bits = 0;
+		for (int x = 0; x < CLAMIR_IMAGE_WIDTH; x += 16)
+		{
+			__m128i first = _mm_cmpgt_epi16(_mm_loadu_si128((const __m128i*)(row + x)), limit);
+			__m128i second = _mm_cmpgt_epi16(_mm_loadu_si128((const __m128i*)(row + x + 8)), limit);
+			bits |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_packs_epi16(first, second)) << x;
+		}
+		Rows[y] = bits;
+	}
+#else
+	for (int y = 0; y < CLAMIR_IMAGE_HEIGHT; y++)
+	{
+		const int16_t* row = aImage + y * CLAMIR_IMAGE_WIDTH;
+		uint64_t bits = 0;
+		for (int x = 0; x < CLAMIR_IMAGE_WIDTH; x++)
+			bits |= (uint64_t)(row[x] > threshold) << x;
+		Rows[y] = bits;
+	}
+#endif
+}
+
+void MeltPoolMask::FromBytes(const uint8_t* mask)
+{
+	for (int y = 0; y < CLAMIR_IMAGE_HEIGHT; y++)
+	{
+		const uint8_t* row = mask + y * CLAMIR_IMAGE_WIDTH;
+		uint64_t bits = 0;
+#if defined(CLAMIR_SSE2)
+		const __m128i zero = _mm_setzero_si128();
+		for (int x = 0; x < CLAMIR_IMAGE_WIDTH; x += 16)
+		{
+			__m128i isZero = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(row + x)), zero);
+			bits |= (uint64_t)(uint32_t)(~_mm_movemask_epi8(isZero) & 0xFFFF) << x;
+		}
+#else
+		for (int x = 0; x < CLAMIR_IMAGE_WIDTH; x++)
+			bits |= (uint64_t)(row[x] != 0) << x;
+#endif
+		Rows[y] = bits;
+	}
+}
+
+void MeltPoolMask::ToBytes(uint8_t* mask) const
+{
+	for (int y = 0; y < CLAMIR_IMAGE_HEIGHT; y++)
+		for (int x = 0; x < CLAMIR_IMAGE_WIDTH; x++)
+			mask[y * CLAMIR_IMAGE_WIDTH + x] = (uint8_t)(0 - (Rows[y] >> x & 1));
+}
+
+void MeltPoolMask::Set(int x, int y, bool value)
+{
+	if (value)
+		Rows[y] |= 1ull << x;
+	else
+		Rows[y] &= ~(1ull << x);
+}
+
+int MeltPoolMask::Count() const
+{
+	int count = 0;
+	for (int y = 0; y < CLAMIR_IMAGE_HEIGHT; y++)
+		count += PopCount(Rows[y]);
+	return count;
+}
+
+bool MeltPoolMask::Empty() const
+{
+	uint64_t bits = 0;
+	for (int y = 0; y < CLAMIR_IMAGE_HEIGHT; y++)
+		bits |= Rows[y];
+	return bits == 0;
+}
+
+void MeltPoolMask::Erode()
+{
+	::Erode(Rows);
+}
+
+void MeltPoolMask::Dilate()
+{
+	::Dilate(Rows);
+}
+
+void MeltPoolMask::Open()
+{
+	::Erode(Rows);
+	::Dilate(Rows);
+}
+
+void MeltPoolMask::Close()
+{
+	::Dilate(Rows);
+	::Erode(Rows);
+}
+
+void MeltPoolMask::Intersect(const MeltPoolMask& other)
+{
+	for (int y = 0; y < CLAMIR_IMAGE_HEIGHT; y++)
+		Rows[y] &= other.Rows[y];
+}
+
+void MeltPoolMask::Unite(const MeltPoolMask& other)
+{
+	for (int y = 0; y < CLAMIR_IMAGE_HEIGHT; y++)
+		Rows[y] |= other.Rows[y];
+}
+
+void MeltPoolMask::Subtract(const MeltPoolMask& other)
+{
+	for (int y = 0; y < CLAMIR_IMAGE_HEIGHT; y++)
+		Rows[y] &= ~other.Rows[y];
+}
+
+bool MeltPoolMask::operator==(const MeltPoolMask& other) const
+{
+	return memcmp(Rows, other.Rows, sizeof(Rows)) == 0;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "ClamirFrame.h"
+#include "ClamirExport.h"
+
+/**
+@class MeltPoolMask
+@brief Binary 64x64 mask stored as one 64 bit word per image row
+
+*Bit x of Rows[y] is pixel (x, y). Morphology works on whole rows with shifts and bitwise operations, so a 3x3 erosion or dilation is a few hundred instructions instead of a pass over 4096 bytes.
+*Erode and Dilate use a 3x3 square structuring element and replicate the border pixels, like CImg<T>::erode(3) and CImg<T>::dilate(3).
+*/
+class CLAMIRLIBRARY_API MeltPoolMask
+{
+public:
+	uint64_t Rows[CLAMIR_IMAGE_HEIGHT];
+
+	void Clear();
+	void Fill();
+
+	/**
+	@brief Sets the pixels strictly above a threshold
+	@param aImage Pointer to an array of 4096 int16_t pixels
+	*/
+	void Build(const int16_t* aImage, int16_t threshold);
+
+	/**
+	@brief Sets the pixels whose byte is not zero, e.g. from a CImg<unsigned char> or a ROI byte mask
+	*/
+	void FromBytes(const uint8_t* mask);
+
+	/**
+	@brief Writes 0xFF for the set pixels and 0 for the others
+	*/
+	void ToBytes(uint8_t* mask) const;
+
+	bool Get(int x, int y) const { return (Rows[y] >> x & 1) != 0; }
+	void Set(int x, int y, bool value);
+
+	/**
+	@returns the number of set pixels
+	*/
+	int Count() const;
+	bool Empty() const;
+
+	void Erode();
+	void Dilate();
+
+	/**
+	@brief Erosion followed by dilation: removes spatter smaller than 3x3
+	*/
+	void Open();
+
+	/**
+	@brief Dilation followed by erosion: fills one pixel gaps
+	*/
+	void Close();
+
+	void Intersect(const MeltPoolMask& other);
+	void Unite(const MeltPoolMask& other);
+	void Subtract(const MeltPoolMask& other);
+
+	bool operator==(const MeltPoolMask& other) const;
+	bool operator!=(const MeltPoolMask& other) const { return !(*this == other); }
+};
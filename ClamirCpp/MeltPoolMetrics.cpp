@@ -0,0 +1,111 @@
+#include "pch.h"
+#include <string.h>
+#include "MeltPoolMetrics.h"
+#include "FrameTrace.h"
+
+#ifdef CLAMIR_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef CLAMIR_AVX2
+#include <immintrin.h>
+#endif
+
+void MeltPoolMetrics::Compute(const int16_t* aImage, int16_t threshold, const uint8_t* roiMask, FrameMetrics* metrics)
+{
+	TraceScope trace(TRACE_ANALYTICS);
+	int i = 0;
+	int area = 0, frameMax = INT16_MIN;
+
+#if defined(CLAMIR_SSE2)
+	// Both paths handle 32 pixels per step. With a mask, the comparisons are packed to bytes so the mask applies without widening
+#if defined(CLAMIR_AVX2)
+	const __m256i limit = _mm256_set1_epi16(threshold);
+	__m256i firstMax = _mm256_set1_epi16(INT16_MIN), secondMax = firstMax;
+	__m256i count = _mm256_setzero_si256();
+	for (; i < CLAMIR_IMAGE_PIXELS; i += 32)
+	{
+		__m256i first = _mm256_loadu_si256((const __m256i*)(aImage + i));
+		__m256i second = _mm256_loadu_si256((const __m256i*)(aImage + i + 16));
+		firstMax = _mm256_max_epi16(firstMax, first);
+		secondMax = _mm256_max_epi16(secondMax, second);
+		// packs interleaves the 128 bit lanes, which does not matter for a count but has to match the mask layout
+		__m256i above = _mm256_permute4x64_epi64(_mm256_packs_epi16(_mm256_cmpgt_epi16(first, limit), _mm256_cmpgt_epi16(second, limit)), 0xD8);
+		if (roiMask)
+			above = _mm256_and_si256(above, _mm256_loadu_si256((const __m256i*)(roiMask + i)));
+		count = _mm256_add_epi64(count, _mm256_sad_epu8(_mm256_sub_epi8(_mm256_setzero_si256(), above), _mm256_setzero_si256()));
+	}
+	__m128i total = _mm_add_epi64(_mm256_castsi256_si128(count), _mm256_extracti128_si256(count, 1));
+	__m128i largest = _mm_max_epi16(_mm256_castsi256_si128(firstMax), _mm256_extracti128_si256(firstMax, 1));
+	largest = _mm_max_epi16(largest, _mm_max_epi16(_mm256_castsi256_si128(secondMax), _mm256_extracti128_si256(secondMax, 1)));
+#else
+	const __m128i limit = _mm_set1_epi16(threshold);
+	const __m128i zero = _mm_setzero_si128();
+	__m128i firstMax = _mm_set1_epi16(INT16_MIN), secondMax = firstMax;
+	__m128i total = zero;
+	for (; i < CLAMIR_IMAGE_PIXELS; i += 32)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)(aImage + i));
+		__m128i b = _mm_loadu_si128((const __m128i*)(aImage + i + 8));
+		__m128i c = _mm_loadu_si128((const __m128i*)(aImage + i + 16));
+		__m128i d = _mm_loadu_si128((const __m128i*)(aImage + i + 24));
+		firstMax = _mm_max_epi16(firstMax, _mm_max_epi16(a, b));
+		secondMax = _mm_max_epi16(secondMax, _mm_max_epi16(c, d));
+		__m128i low = _mm_packs_epi16(_mm_cmpgt_epi16(a, limit), _mm_cmpgt_epi16(b, limit));
+		__m128i high = _mm_packs_epi16(_mm_cmpgt_epi16(c, limit), _mm_cmpgt_epi16(d, limit));
+		if (roiMask)
+		{
+			low = _mm_and_si128(low, _mm_loadu_si128((const __m128i*)(roiMask + i)));
+			high = _mm_and_si128(high, _mm_loadu_si128((const __m128i*)(roiMask + i + 16)));
+		}
+		// Each byte is 0 or -1 and at most 2 are added per lane, so the sum of absolute values is the count
+		__m128i above = _mm_sub_epi8(_mm_sub_epi8(zero, low), high);
+		total = _mm_add_epi64(total, _mm_sad_epu8(above, zero));
+	}
+	__m128i largest = _mm_max_epi16(firstMax, secondMax);
+#endif
+	total = _mm_add_epi64(total, _mm_srli_si128(total, 8));
+	area = _mm_cvtsi128_si32(total);
+	largest = _mm_max_epi16(largest, _mm_srli_si128(largest, 8));
+	largest = _mm_max_epi16(largest, _mm_srli_si128(largest, 4));
+	largest = _mm_max_epi16(largest, _mm_srli_si128(largest, 2));
+	frameMax = (int16_t)_mm_extract_epi16(largest, 0);
+#endif
+
+	for (; i < CLAMIR_IMAGE_PIXELS; i++)
+	{
+		int value = aImage[i];
+		if (value > frameMax)
+			frameMax = value;
+		if (value > threshold && (!roiMask || roiMask[i]))
+			area++;
+	}
+
+	metrics->MeltPoolArea = area;
+	metrics->FrameMax = frameMax;
+}
+
+void MeltPoolMetrics::RectangleMask(int x1, int y1, int x2, int y2, uint8_t* roiMask)
+{
+	memset(roiMask, 0, CLAMIR_IMAGE_PIXELS);
+	if (x1 < 0)
+		x1 = 0;
+	if (y1 < 0)
+		y1 = 0;
+	if (x2 >= CLAMIR_IMAGE_WIDTH)
+		x2 = CLAMIR_IMAGE_WIDTH - 1;
+	if (y2 >= CLAMIR_IMAGE_HEIGHT)
+		y2 = CLAMIR_IMAGE_HEIGHT - 1;
+	for (int y = y1; y <= y2 && x1 <= x2; y++)
+		memset(roiMask + y * CLAMIR_IMAGE_WIDTH + x1, 0xFF, x2 - x1 + 1);
+}
+
+int MeltPoolMetrics::Compare(const ImageHeader& header, const FrameMetrics& metrics, int areaTolerance)
+{
+	int flags = 0;
+	int difference = header.MeltPoolArea - metrics.MeltPoolArea;
+	if (difference > areaTolerance || difference < -areaTolerance)
+		flags |= CLAMIR_METRICS_AREA_MISMATCH;
+	if (header.FrameMax != metrics.FrameMax)
+		flags |= CLAMIR_METRICS_MAX_MISMATCH;
+	return flags;
+}
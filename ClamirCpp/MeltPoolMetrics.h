@@ -0,0 +1,52 @@
+#pragma once
+
+#include "ClamirFrame.h"
+#include "ClamirExport.h"
+
+// Flags returned by MeltPoolMetrics::Compare
+#define CLAMIR_METRICS_AREA_MISMATCH 0x01
+#define CLAMIR_METRICS_MAX_MISMATCH 0x02
+
+/**
+@brief Melt pool measurements recomputed on the host
+*/
+struct FrameMetrics
+{
+	// Pixels above the threshold inside the ROI, as ImageHeader::MeltPoolArea
+	int MeltPoolArea;
+	// Maximum of the whole frame, as ImageHeader::FrameMax
+	int FrameMax;
+};
+
+/**
+@class MeltPoolMetrics
+@brief Vectorized recomputation of MeltPoolArea and FrameMax from the 4096 pixels of a frame
+
+*Used to check the firmware measurements at full frame rate, or to measure with another threshold than the one configured on the device.
+*The ROI is a mask of 4096 bytes, 0xFF inside and 0 outside, in the pixel order of the image. A pixel counts towards the area when it is strictly above the threshold, as ThresholdSet documents.
+*Runs with SSE2, or AVX2 when the build enables it, in a fraction of a microsecond per frame.
+*/
+class CLAMIRLIBRARY_API MeltPoolMetrics
+{
+public:
+	/**
+	@brief Measures a frame
+	@param aImage Pointer to an array of 4096 int16_t pixels
+	@param threshold Threshold in digital counts, as read by ThresholdGet
+	@param roiMask ROI mask, or a null pointer when the ROI is disabled
+	@param metrics Receives the measurements
+	*/
+	static void Compute(const int16_t* aImage, int16_t threshold, const uint8_t* roiMask, FrameMetrics* metrics);
+
+	/**
+	@brief Fills a rectangular ROI mask from the coordinates of ROICoordinatesGet, both corners included
+	*/
+	static void RectangleMask(int x1, int y1, int x2, int y2, uint8_t* roiMask);
+
+	/**
+	@brief Compares recomputed measurements with the ones of the header
+	@param areaTolerance Largest area difference that is not reported
+	@returns 0 if they agree, otherwise a combination of CLAMIR_METRICS_AREA_MISMATCH and CLAMIR_METRICS_MAX_MISMATCH
+	*/
+	static int Compare(const ImageHeader& header, const FrameMetrics& metrics, int areaTolerance = 0);
+};
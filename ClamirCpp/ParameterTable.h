@@ -0,0 +1,198 @@
+#pragma once
+
+#include <stddef.h>
+#include "ClamirParameters.h"
+
+enum ParameterType
+{
+	PARAMETER_TYPE_INT16 = 0,
+	PARAMETER_TYPE_INT,
+	PARAMETER_TYPE_FLOAT
+};
+
+template <typename T> struct ParameterTypeOf;
+template <> struct ParameterTypeOf<int16_t> { static constexpr int Value = PARAMETER_TYPE_INT16; };
+template <> struct ParameterTypeOf<int> { static constexpr int Value = PARAMETER_TYPE_INT; };
+template <> struct ParameterTypeOf<float> { static constexpr int Value = PARAMETER_TYPE_FLOAT; };
+
+/**
+* @struct ParameterDescriptor
+* @brief Description of one writable field of ParameterSnapshot
+* @param Name Name of the field, which is the name of its Get and Set functions for the scalar parameters
+* @param Type One of the ParameterType values
+* @param Min Max Documented bounds, inclusive
+* @param Default Documented default value
+* @param Offset Offset of the field in ParameterSnapshot
+* @param Parameter ParameterId of the Set function writing the field
+*/
+struct ParameterDescriptor
+{
+	const char* Name;
+	int Type;
+	double Min, Max, Default;
+	size_t Offset;
+	int Parameter;
+};
+
+/**
+*Every writable field of ParameterSnapshot: the scalar parameters, indexed by their ParameterId, then the ROI coordinates and the autoshutter flags.
+*/
+constexpr ParameterDescriptor parameter_descriptors[] =
+{
+#define CLAMIR_PARAMETER_DESCRIPTOR(name, type, min, max, value) \
+	{ #name, ParameterTypeOf<type>::Value, min, max, value, offsetof(ParameterSnapshot, name), PARAMETER_##name },
+	CLAMIR_SCALAR_PARAMETERS(CLAMIR_PARAMETER_DESCRIPTOR)
+#undef CLAMIR_PARAMETER_DESCRIPTOR
+	{ "ROIX1", PARAMETER_TYPE_INT16, 1, 62, 2, offsetof(ParameterSnapshot, ROIX1), PARAMETER_ROICoordinates },
+	{ "ROIY1", PARAMETER_TYPE_INT16, 1, 62, 2, offsetof(ParameterSnapshot, ROIY1), PARAMETER_ROICoordinates },
+	{ "ROIX2", PARAMETER_TYPE_INT16, 2, 63, 61, offsetof(ParameterSnapshot, ROIX2), PARAMETER_ROICoordinates },
+	{ "ROIY2", PARAMETER_TYPE_INT16, 2, 63, 61, offsetof(ParameterSnapshot, ROIY2), PARAMETER_ROICoordinates },
+	{ "AutoShutterFlagEnable", PARAMETER_TYPE_INT, 0, 1, 0, offsetof(ParameterSnapshot, AutoShutterFlagEnable), PARAMETER_AutoShutterConfiguration },
+	{ "AutoShutterFlagEnableInProcess", PARAMETER_TYPE_INT, 0, 1, 0, offsetof(ParameterSnapshot, AutoShutterFlagEnableInProcess), PARAMETER_AutoShutterConfiguration },
+	{ "AutoShutterFlagTemperatureDrift", PARAMETER_TYPE_INT, 0, 1, 1, offsetof(ParameterSnapshot, AutoShutterFlagTemperatureDrift), PARAMETER_AutoShutterConfiguration },
+	{ "AutoShutterFlagTimer", PARAMETER_TYPE_INT, 0, 1, 0, offsetof(ParameterSnapshot, AutoShutterFlagTimer), PARAMETER_AutoShutterConfiguration },
+};
+
+#define CLAMIR_PARAMETER_FIELDS ((int)(sizeof(parameter_descriptors) / sizeof(parameter_descriptors[0])))
+#define CLAMIR_FIELD_ROIX1 PARAMETER_ROICoordinates
+#define CLAMIR_FIELD_AUTO_SHUTTER (PARAMETER_ROICoordinates + 4)
+
+enum ParameterRelation
+{
+	// First below Second
+	PARAMETER_BELOW = 0,
+	// First not above Second
+	PARAMETER_NOT_ABOVE,
+	// Exactly one of two 0/1 flags set
+	PARAMETER_EXACTLY_ONE
+};
+
+/**
+@brief Relation that must hold between two fields, which are indices in parameter_descriptors
+@param Relation One of the ParameterRelation values
+@param Code Error code returned by the device, and by the checks below, when the relation is broken
+*/
+struct ParameterConstraint
+{
+	int First, Second;
+	int Relation;
+	int Code;
+};
+
+constexpr ParameterConstraint parameter_constraints[] =
+{
+	{ PARAMETER_MinPower, PARAMETER_MaxPower, PARAMETER_BELOW, -4 },
+	{ PARAMETER_PowerLimitMin, PARAMETER_PowerLimitMax, PARAMETER_BELOW, -4 },
+	{ PARAMETER_AlarmMin, PARAMETER_AlarmMax, PARAMETER_BELOW, -4 },
+	{ PARAMETER_ReferenceTrackStart, PARAMETER_ReferenceTrackEnd, PARAMETER_NOT_ABOVE, -4 },
+	{ CLAMIR_FIELD_ROIX1, CLAMIR_FIELD_ROIX1 + 2, PARAMETER_BELOW, -4 },
+	{ CLAMIR_FIELD_ROIX1 + 1, CLAMIR_FIELD_ROIX1 + 3, PARAMETER_BELOW, -4 },
+	// The temperature drift and timer activations of the autoshutter are exclusive and one of them must be selected
+	{ CLAMIR_FIELD_AUTO_SHUTTER + 2, CLAMIR_FIELD_AUTO_SHUTTER + 3, PARAMETER_EXACTLY_ONE, -3 },
+};
+
+#define CLAMIR_PARAMETER_CONSTRAINTS ((int)(sizeof(parameter_constraints) / sizeof(parameter_constraints[0])))
+
+/**
+@brief Value of a field of a snapshot
+@param field Index in parameter_descriptors
+*/
+inline double ParameterFieldValue(const ParameterSnapshot& snapshot, int field)
+{
+	const ParameterDescriptor& descriptor = parameter_descriptors[field];
+	const char* address = (const char*)&snapshot + descriptor.Offset;
+	switch (descriptor.Type)
+	{
+	case PARAMETER_TYPE_INT16: return *(const int16_t*)address;
+	case PARAMETER_TYPE_INT: return *(const int*)address;
+	default: return *(const float*)address;
+	}
+}
+
+/**
+@brief Stores a value in a field of a snapshot, rounded to the nearest integer for the integer fields
+@param field Index in parameter_descriptors
+*/
+inline void SetParameterFieldValue(ParameterSnapshot* snapshot, int field, double value)
+{
+	const ParameterDescriptor& descriptor = parameter_descriptors[field];
+	char* address = (char*)snapshot + descriptor.Offset;
+	double rounded = value < 0.0 ? value - 0.5 : value + 0.5;
+	switch (descriptor.Type)
+	{
+	case PARAMETER_TYPE_INT16: *(int16_t*)address = (int16_t)rounded; break;
+	case PARAMETER_TYPE_INT: *(int*)address = (int)rounded; break;
+	default: *(float*)address = (float)value; break;
+	}
+}
+
+/**
+@brief Checks a value against the bounds of its field, in the precision of the field
+@returns true if the value is within the bounds
+*/
+inline bool ParameterInBounds(int field, double value)
+{
+	const ParameterDescriptor& descriptor = parameter_descriptors[field];
+	if (descriptor.Type == PARAMETER_TYPE_FLOAT)
+		return (float)value >= (float)descriptor.Min && (float)value <= (float)descriptor.Max;
+	return value >= descriptor.Min && value <= descriptor.Max;
+}
+
+inline bool ParameterConstraintHolds(const ParameterSnapshot& snapshot, const ParameterConstraint& constraint)
+{
+	double first = ParameterFieldValue(snapshot, constraint.First), second = ParameterFieldValue(snapshot, constraint.Second);
+	switch (constraint.Relation)
+	{
+	case PARAMETER_BELOW: return first < second;
+	case PARAMETER_NOT_ABOVE: return first <= second;
+	default: return (first != 0.0) != (second != 0.0);
+	}
+}
+
+/**
+@brief Checks the constraints of a snapshot that involve a field, or all of them when field is -1
+@returns 0 if they hold, or the Code of the first broken one
+*/
+inline int ParameterConstraintViolation(const ParameterSnapshot& snapshot, int field = -1)
+{
+	for (int i = 0; i < CLAMIR_PARAMETER_CONSTRAINTS; i++)
+	{
+		const ParameterConstraint& constraint = parameter_constraints[i];
+		if (field >= 0 && constraint.First != field && constraint.Second != field)
+			continue;
+		if (!ParameterConstraintHolds(snapshot, constraint))
+			return constraint.Code;
+	}
+	return 0;
+}
+
+/**
+@brief Checks the constraints between the fields of one multi-valued parameter, such as the ROI corners or the autoshutter flags. The other fields of the snapshot are ignored
+@param parameter ParameterId of the Set function writing the fields
+@returns 0 if they hold, or the Code of the first broken one
+*/
+inline int ParameterInternalViolation(const ParameterSnapshot& snapshot, int parameter)
+{
+	for (int i = 0; i < CLAMIR_PARAMETER_CONSTRAINTS; i++)
+	{
+		const ParameterConstraint& constraint = parameter_constraints[i];
+		if (parameter_descriptors[constraint.First].Parameter == parameter && parameter_descriptors[constraint.Second].Parameter == parameter &&
+			!ParameterConstraintHolds(snapshot, constraint))
+			return constraint.Code;
+	}
+	return 0;
+}
+
+inline bool ParameterConstraintsHold(const ParameterSnapshot& snapshot, int field = -1)
+{
+	return ParameterConstraintViolation(snapshot, field) == 0;
+}
+
+/**
+@brief Type of a scalar parameter, for the typed ClamirFunctions::Get and Set
+*/
+template <int Id> struct ParameterTraits;
+#define CLAMIR_PARAMETER_TRAITS(name, type, ...) \
+template <> struct ParameterTraits<PARAMETER_##name> { typedef type Type; };
+CLAMIR_SCALAR_PARAMETERS(CLAMIR_PARAMETER_TRAITS)
+#undef CLAMIR_PARAMETER_TRAITS
@@ -0,0 +1,268 @@
+#include "pch.h"
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include "PidReplay.h"
+#include "TelemetryStore.h"
+#include "ClamirFunctions.h"
+
+namespace
+{
+	const int min_plant_samples = 16;
+
+	inline bool LaserDetected(char state)
+	{
+		return state != CLAMIR_STATE_IDLE && state != CLAMIR_STATE_MANUAL;
+	}
+}
+
+PidReplay::PidReplay() : frameRate(1000.0), fitted(false)
+{
+	plant.A = plant.B = plant.C = plant.Residual = 0.0;
+	plant.Samples = 0;
+}
+
+void PidReplay::Clear()
+{
+	widths.clear();
+	refWidths.clear();
+	powers.clear();
+	states.clear();
+	disturbances.clear();
+	fitted = false;
+}
+
+void PidReplay::Add(const ImageHeader& header)
+{
+	widths.push_back(header.Width);
+	refWidths.push_back(header.RefWidth);
+	powers.push_back((float)header.Power);
+	states.push_back(header.StateMachine);
+	fitted = false;
+}
+
+int PidReplay::Load(const TelemetryStore& store)
+{
+	Clear();
+	uint64_t rows = store.RowCount();
+	std::vector<double> values((size_t)rows);
+	const int columns[4] = { TELEMETRY_WIDTH, TELEMETRY_REF_WIDTH, TELEMETRY_POWER, TELEMETRY_STATE_MACHINE };
+	std::vector<float>* targets[3] = { &widths, &refWidths, &powers };
+	for (int c = 0; c < 4; c++)
+	{
+		int result = store.ReadColumn(columns[c], 0, rows, values.data());
+		if (result != 0)
+		{
+			Clear();
+			return result;
+		}
+		if (c < 3)
+			targets[c]->assign(values.begin(), values.end());
+		else
+			for (double value : values)
+				states.push_back((char)value);
+	}
+	return 0;
+}
+
+int PidReplay::FitPlant()
+{
+	fitted = false;
+	int frames = FrameCount();
+	disturbances.assign(frames, 0.0f);
+
+	// Least squares on first differences. Slow drifts such as the heating along a track move the width and, through the controller, the power,
+	// which biases a fit on the levels towards a gain of the wrong sign; differencing removes them
+	double ww = 0.0, wp = 0.0, pp = 0.0, wy = 0.0, py = 0.0;
+	int n = 0;
+	for (int k = 2; k < frames; k++)
+		if (LaserDetected(states[k - 2]) && LaserDetected(states[k - 1]) && LaserDetected(states[k]))
+		{
+			double w = widths[k - 1] - widths[k - 2], p = powers[k - 1] - powers[k - 2], y = widths[k] - widths[k - 1];
+			ww += w * w;
+			wp += w * p;
+			pp += p * p;
+			wy += w * y;
+			py += p * y;
+			n++;
+		}
+	double determinant = ww * pp - wp * wp;
+	if (n < min_plant_samples || ww <= 0.0 || pp <= 0.0 || determinant <= 1e-9 * ww * pp)
+		return -1;
+	plant.A = (wy * pp - py * wp) / determinant;
+	plant.B = (py * ww - wy * wp) / determinant;
+
+	// The offset then makes the mean one step prediction error zero
+	double offset = 0.0;
+	n = 0;
+	for (int k = 1; k < frames; k++)
+		if (LaserDetected(states[k - 1]) && LaserDetected(states[k]))
+		{
+			offset += widths[k] - plant.A * widths[k - 1] - plant.B * powers[k - 1];
+			n++;
+		}
+	plant.C = offset / n;
+	plant.Samples = n;
+
+	double squares = 0.0;
+	for (int k = 1; k < frames; k++)
+		if (LaserDetected(states[k - 1]) && LaserDetected(states[k]))
+		{
+			double residual = widths[k] - (plant.A * widths[k - 1] + plant.B * powers[k - 1] + plant.C);
+			disturbances[k] = (float)residual;
+			squares += residual * residual;
+		}
+	plant.Residual = sqrt(squares / n);
+	fitted = true;
+	return 0;
+}
+
+int PidReplay::Replay(const PidParameters& p, bool closedLoop, PidScore* score, float* powerOut) const
+{
+	if (closedLoop && !fitted)
+		return -1;
+
+	int frames = FrameCount();
+	double dt = 1.0 / frameRate;
+	int bufferSize = std::max<int>(1, std::min<int>(p.CircularBufferSize, 512));
+	double buffer[512];
+	int bufferNext = 0, bufferCount = 0;
+	double bufferSum = 0.0;
+	double lower = std::max<double>(p.PowerLimitMin, p.MinPower);
+	double upper = std::min<double>(p.PowerLimitMax, p.MaxPower);
+
+	// The recorded power of the first frame stands for the device state before the recording
+	double power = frames > 0 && powers[0] > 0.0f ? powers[0] : 0.0;
+	double integral = 0.0, lastError = 0.0;
+	bool detected = false;
+	double laserOnSince = 0.0;
+	double width = 0.0;
+
+	PidScore result = { 0, 0.0, 0.0, 0.0, 0.0, 0 };
+	double squares = 0.0, powerSum = 0.0;
+
+	for (int k = 0; k < frames; k++)
+	{
+		double t = k * dt;
+		char state = states[k];
+		bool wasDetected = detected;
+		detected = LaserDetected(state);
+
+		// The frame is produced with the power applied before this step
+		double applied = power > 0.0 ? power : p.ManualPower;
+		if (closedLoop && k > 0 && wasDetected && detected)
+			width = std::max(0.0, plant.A * width + plant.B * applied + plant.C + disturbances[k]);
+		else
+			width = widths[k];
+
+		if (detected && !wasDetected)
+			laserOnSince = t;
+
+		if (bufferCount == bufferSize)
+			bufferSum -= buffer[bufferNext];
+		else
+			bufferCount++;
+		buffer[bufferNext] = width;
+		bufferSum += width;
+		bufferNext = (bufferNext + 1) % bufferSize;
+		double averageWidth = bufferSum / bufferCount;
+
+		double target = state == CLAMIR_STATE_PREHEATING ? p.PreheatingPower : p.ManualPower;
+		if (state == CLAMIR_STATE_CONTROL && (t - laserOnSince) * 1000.0 >= p.LaserONDelay)
+		{
+			double error = refWidths[k] - averageWidth;
+			integral = std::min(std::max(integral + p.KI * error * dt, -(double)p.LimitIntegral), (double)p.LimitIntegral);
+			double derivative = p.KD * (error - lastError) / (dt * 1000.0);
+			lastError = error;
+			target = p.ManualPower + p.KP * error + integral + derivative;
+			if (target < lower || target > upper)
+				result.SaturatedFrames++;
+			target = std::min(std::max(target, lower), upper);
+		}
+		else
+		{
+			integral = 0.0;
+			lastError = 0.0;
+		}
+
+		double previous = power;
+		double maxStep = p.LimitSlewRate * dt * 1000.0;
+		double current = power > 0.0 ? power : target;
+		power = current + std::min(std::max(target - current, -maxStep), maxStep);
+		if (powerOut)
+			powerOut[k] = (float)power;
+
+		if (state == CLAMIR_STATE_CONTROL)
+		{
+			double error = fabs(refWidths[k] - width);
+			result.ControlFrames++;
+			squares += error * error;
+			result.MaxError = std::max(result.MaxError, error);
+			powerSum += power;
+			result.PowerTravel += fabs(power - previous);
+		}
+	}
+
+	if (result.ControlFrames)
+	{
+		result.RmsError = sqrt(squares / result.ControlFrames);
+		result.MeanPower = powerSum / result.ControlFrames;
+	}
+	*score = result;
+	return 0;
+}
+
+int PidReplay::Evaluate(const PidParameters* candidates, int count, PidScore* scores, int threads) const
+{
+	if (!fitted)
+		return -1;
+	if (threads <= 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	threads = std::min(threads, count);
+
+	// Candidates are handed out one at a time, so threads stay busy when replays differ in cost
+	std::atomic<int> next(0);
+	auto work = [&]()
+	{
+		for (int i = next++; i < count; i = next++)
+			Replay(candidates[i], true, &scores[i]);
+	};
+	std::vector<std::thread> pool;
+	for (int i = 1; i < threads; i++)
+		pool.emplace_back(work);
+	work();
+	for (std::thread& thread : pool)
+		thread.join();
+	return 0;
+}
+
+int PidReplay::ReadParameters(PidParameters* parameters)
+{
+	int result = ClamirFunctions::KPGet(&parameters->KP);
+	if (result == 0)
+		result = ClamirFunctions::KIGet(&parameters->KI);
+	if (result == 0)
+		result = ClamirFunctions::KDGet(&parameters->KD);
+	if (result == 0)
+		result = ClamirFunctions::LimitIntegralGet(&parameters->LimitIntegral);
+	if (result == 0)
+		result = ClamirFunctions::LimitSlewRateGet(&parameters->LimitSlewRate);
+	if (result == 0)
+		result = ClamirFunctions::MaxPowerGet(&parameters->MaxPower);
+	if (result == 0)
+		result = ClamirFunctions::MinPowerGet(&parameters->MinPower);
+	if (result == 0)
+		result = ClamirFunctions::PowerLimitMaxGet(&parameters->PowerLimitMax);
+	if (result == 0)
+		result = ClamirFunctions::PowerLimitMinGet(&parameters->PowerLimitMin);
+	if (result == 0)
+		result = ClamirFunctions::ManualPowerGet(&parameters->ManualPower);
+	if (result == 0)
+		result = ClamirFunctions::PreheatingPowerGet(&parameters->PreheatingPower);
+	if (result == 0)
+		result = ClamirFunctions::CircularBufferSizeGet(&parameters->CircularBufferSize);
+	if (result == 0)
+		result = ClamirFunctions::LaserONDelayGet(&parameters->LaserONDelay);
+	return result;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <vector>
+#include "ClamirFrame.h"
+#include "ClamirExport.h"
+
+class TelemetryStore;
+
+/**
+@brief Device parameters of the control law, in the units of their Set functions
+*/
+struct PidParameters
+{
+	int16_t KP, KI, KD;
+	int16_t LimitIntegral;
+	// W/ms
+	float LimitSlewRate;
+	int16_t MaxPower, MinPower;
+	int16_t PowerLimitMax, PowerLimitMin;
+	// Power of the set point tracks and bias of the PID output
+	int16_t ManualPower;
+	int16_t PreheatingPower;
+	// Frames averaged into the controlled width
+	int16_t CircularBufferSize;
+	// Wait after the laser detection before the PID acts, in milliseconds as the simulator applies it
+	int16_t LaserONDelay;
+};
+
+/**
+@brief Width dynamics fitted on a recording: Width[k] = A * Width[k-1] + B * Power[k-1] + C while the laser is detected
+*/
+struct PidPlant
+{
+	double A, B, C;
+	// Root mean square of the one step prediction error, in mm
+	double Residual;
+	int Samples;
+};
+
+/**
+@brief Result of a replay, over the frames in CLAMIR_STATE_CONTROL
+*/
+struct PidScore
+{
+	int ControlFrames;
+	// Error of the instantaneous width against the reference width, in mm
+	double RmsError, MaxError;
+	double MeanPower;
+	// Sum of the absolute power changes between frames, in W
+	double PowerTravel;
+	// Frames where the PID output was clamped by a power limit
+	int SaturatedFrames;
+};
+
+/**
+@class PidReplay
+@brief Offline model of the device control law for screening PID parameters on a recording
+
+*The law is the one of the simulator: PID on the width averaged over CircularBufferSize frames, integral clamped to LimitIntegral, output added to ManualPower, clamped to the power limits and slew limited to LimitSlewRate.
+*Replay with closedLoop false feeds the recorded widths to the law, which reproduces the recorded power for the parameters the recording was made with.
+*With closedLoop true the widths come from the fitted plant driven by the replayed power, plus the part of the recorded widths the plant does not explain, so new gains see both the process response and the recorded disturbances.
+*The reference width and the state machine are taken from the recording. The replay starts with a reset integral, so recordings should start before the control tracks.
+*/
+class CLAMIRLIBRARY_API PidReplay
+{
+public:
+	PidReplay();
+
+	void Clear();
+
+	/**
+	@brief Adds the next frame of the recording
+	*/
+	void Add(const ImageHeader& header);
+
+	/**
+	@brief Replaces the recording with the rows of a telemetry file
+	@returns 0 on success
+	@returns the error code of TelemetryStore::ReadColumn otherwise
+	*/
+	int Load(const TelemetryStore& store);
+
+	int FrameCount() const { return (int)widths.size(); }
+
+	/**
+	@brief Sets the frame rate of the recording, 1000 by default
+	*/
+	void SetFrameRate(double rate) { frameRate = rate > 0.0 ? rate : 1000.0; }
+
+	/**
+	@brief Fits the plant by least squares on the first differences of the consecutive frames where the laser is detected
+	@returns 0 on success
+	@returns -1 if the recording has too few such frames or does not excite the power
+	*/
+	int FitPlant();
+	const PidPlant& Plant() const { return plant; }
+
+	/**
+	@brief Replays the recording with a set of parameters. Thread-safe
+	@param power If not null, receives the power of every frame
+	@returns 0 on success
+	@returns -1 if closedLoop is true and the plant has not been fitted
+	*/
+	int Replay(const PidParameters& parameters, bool closedLoop, PidScore* score, float* power = 0) const;
+
+	/**
+	@brief Replays the recording in closed loop for every candidate, spread over a pool of threads
+	@param threads Number of threads, 0 for one per hardware thread
+	@returns 0 on success
+	@returns -1 if the plant has not been fitted
+	*/
+	int Evaluate(const PidParameters* candidates, int count, PidScore* scores, int threads = 0) const;
+
+	/**
+	@brief Reads the control parameters of the connected device
+	@returns 0 on success, or the error code of the failed call
+	*/
+	static int ReadParameters(PidParameters* parameters);
+
+private:
+	std::vector<float> widths, refWidths, powers;
+	std::vector<char> states;
+	// Recorded width minus the plant prediction, 0 where the laser is not detected
+	std::vector<float> disturbances;
+	double frameRate;
+	PidPlant plant;
+	bool fitted;
+};
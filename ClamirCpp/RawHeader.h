@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string.h>
+#include "ClamirFrame.h"
+
+/**
+*Word layout of the 60 byte raw header returned by GetImageRawHeader.
+*CLAMIR_dll.h only documents the size of this header, so the layout below is the one produced by the ClamirSim backend and assumed by the replay, recorder and index code.
+*It is kept in this single file so it can be corrected in one place against real NIT .dat captures.
+*Float fields are stored as their IEEE-754 bit pattern. The timestamp is the acquisition time in microseconds, split in two 32 bit words.
+*/
+enum RawHeaderWord
+{
+	RAW_POWER = 0,
+	RAW_MELT_POOL_AREA = 1,
+	RAW_TRACK_NUM = 2,
+	RAW_FRAME_MAX = 3,
+	RAW_FRAME_NUM = 4,
+	RAW_WIDTH = 5,
+	RAW_REF_WIDTH = 6,
+	RAW_TEMPERATURE = 7,
+	RAW_LASER_STATUS = 8,
+	RAW_STATE_MACHINE = 9,
+	RAW_IO_DIGITAL_PORT_STATUS = 10,
+	RAW_TIMESTAMP_LOW = 11,
+	RAW_TIMESTAMP_HIGH = 12
+};
+
+inline float RawHeaderFloat(const int* rawHeader, int word)
+{
+	float value;
+	memcpy(&value, &rawHeader[word], sizeof(float));
+	return value;
+}
+
+inline uint64_t RawHeaderTimestamp(const int* rawHeader)
+{
+	return (uint64_t)(uint32_t)rawHeader[RAW_TIMESTAMP_HIGH] << 32 | (uint32_t)rawHeader[RAW_TIMESTAMP_LOW];
+}
+
+inline void DecodeRawHeader(const int* rawHeader, ImageHeader* header)
+{
+	header->Power = rawHeader[RAW_POWER];
+	header->MeltPoolArea = rawHeader[RAW_MELT_POOL_AREA];
+	header->TrackNum = rawHeader[RAW_TRACK_NUM];
+	header->FrameMax = rawHeader[RAW_FRAME_MAX];
+	header->FrameNum = rawHeader[RAW_FRAME_NUM];
+	header->Width = RawHeaderFloat(rawHeader, RAW_WIDTH);
+	header->RefWidth = RawHeaderFloat(rawHeader, RAW_REF_WIDTH);
+	header->Temperature = RawHeaderFloat(rawHeader, RAW_TEMPERATURE);
+	header->LaserStatus = (char)rawHeader[RAW_LASER_STATUS];
+	header->StateMachine = (char)rawHeader[RAW_STATE_MACHINE];
+	header->IODigitalPortStatus = (int16_t)rawHeader[RAW_IO_DIGITAL_PORT_STATUS];
+}
+
+inline void EncodeRawHeader(const ImageHeader& header, uint64_t timestamp, int* rawHeader)
+{
+	memset(rawHeader, 0, CLAMIR_RAW_HEADER_BYTES);
+	rawHeader[RAW_POWER] = header.Power;
+	rawHeader[RAW_MELT_POOL_AREA] = header.MeltPoolArea;
+	rawHeader[RAW_TRACK_NUM] = header.TrackNum;
+	rawHeader[RAW_FRAME_MAX] = header.FrameMax;
+	rawHeader[RAW_FRAME_NUM] = header.FrameNum;
+	memcpy(&rawHeader[RAW_WIDTH], &header.Width, sizeof(float));
+	memcpy(&rawHeader[RAW_REF_WIDTH], &header.RefWidth, sizeof(float));
+	memcpy(&rawHeader[RAW_TEMPERATURE], &header.Temperature, sizeof(float));
+	rawHeader[RAW_LASER_STATUS] = header.LaserStatus;
+	rawHeader[RAW_STATE_MACHINE] = header.StateMachine;
+	rawHeader[RAW_IO_DIGITAL_PORT_STATUS] = header.IODigitalPortStatus;
+	rawHeader[RAW_TIMESTAMP_LOW] = (int)(uint32_t)timestamp;
+	rawHeader[RAW_TIMESTAMP_HIGH] = (int)(uint32_t)(timestamp >> 32);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "ClamirFrame.h"
+
+/**
+*Geometry of the device ROI, as configured by EnableROISet, ROICoordinatesSet and RoundROISet.
+*CLAMIR_dll.h only says that rounding nullifies the vertices of the ROI depending on its size and on the rounding mode, so the shape below is assumed: each corner is cut by a quarter circle whose radius is a fraction of half the smaller side of the ROI, 1/4 for minimum, 1/2 for medium and all of it for maximum rounding.
+*Coordinates are pixel indices and both corners are included. The ClamirSim backend and RoiMaskCache both use this function, so it is the single place to correct against the device.
+*Host measurements agree with ClamirSim by construction, which says nothing about the firmware: the rounded modes have not been compared with MeltPoolArea values from a real CLAMIR.
+*/
+struct RoiSettings
+{
+	int Enable;
+	int16_t X1, Y1, X2, Y2, Round;
+};
+
+inline bool operator==(const RoiSettings& a, const RoiSettings& b)
+{
+	return a.Enable == b.Enable && a.X1 == b.X1 && a.Y1 == b.Y1 && a.X2 == b.X2 && a.Y2 == b.Y2 && a.Round == b.Round;
+}
+
+inline bool operator!=(const RoiSettings& a, const RoiSettings& b)
+{
+	return !(a == b);
+}
+
+inline bool RoiContains(const RoiSettings& roi, int x, int y)
+{
+	if (!roi.Enable)
+		return true;
+	if (x < roi.X1 || x > roi.X2 || y < roi.Y1 || y > roi.Y2)
+		return false;
+	if (roi.Round <= 0)
+		return true;
+
+	static const float round_fractions[4] = { 0.0f, 0.25f, 0.5f, 1.0f };
+	float width = (float)(roi.X2 - roi.X1 + 1), height = (float)(roi.Y2 - roi.Y1 + 1);
+	float radius = round_fractions[roi.Round > 3 ? 3 : roi.Round] * 0.5f * (width < height ? width : height);
+
+	// Distance of the pixel centre past the straight edges, towards the nearest corner
+	float cx = x + 0.5f, cy = y + 0.5f;
+	float left = roi.X1 + radius - cx, right = cx - (roi.X2 + 1 - radius);
+	float top = roi.Y1 + radius - cy, bottom = cy - (roi.Y2 + 1 - radius);
+	float dx = left > right ? left : right;
+	float dy = top > bottom ? top : bottom;
+	if (dx <= 0.0f || dy <= 0.0f)
+		return true;
+	return dx * dx + dy * dy <= radius * radius;
+}
@@ -0,0 +1,56 @@
+#include "pch.h"
+#include "RoiMaskCache.h"
+#include "ClamirFunctions.h"
+
+RoiMaskCache::RoiMaskCache() : version(0), indexCount(0)
+{
+	settings.Enable = 0;
+	settings.X1 = settings.Y1 = 2;
+	settings.X2 = settings.Y2 = 61;
+	settings.Round = 0;
+	Rebuild();
+}
+
+bool RoiMaskCache::Update(const RoiSettings& newSettings)
+{
+	if (newSettings == settings)
+		return false;
+	settings = newSettings;
+	Rebuild();
+	return true;
+}
+
+int RoiMaskCache::Refresh()
+{
+	RoiSettings device;
+	int result = ClamirFunctions::EnableROIGet(&device.Enable);
+	if (result == 0)
+		result = ClamirFunctions::ROICoordinatesGet(&device.X1, &device.Y1, &device.X2, &device.Y2);
+	if (result == 0)
+		result = ClamirFunctions::RoundROIGet(&device.Round);
+	if (result == 0)
+		Update(device);
+	return result;
+}
+
+void RoiMaskCache::Rebuild()
+{
+	indexCount = 0;
+	for (int y = 0; y < CLAMIR_IMAGE_HEIGHT; y++)
+	{
+		uint64_t row = 0;
+		for (int x = 0; x < CLAMIR_IMAGE_WIDTH; x++)
+		{
+			int i = y * CLAMIR_IMAGE_WIDTH + x;
+			bool inside = RoiContains(settings, x, y);
+			bytes[i] = inside ? 0xFF : 0;
+			if (inside)
+			{
+				row |= 1ull << x;
+				indices[indexCount++] = (uint16_t)i;
+			}
+		}
+		mask.Rows[y] = row;
+	}
+	version++;
+}
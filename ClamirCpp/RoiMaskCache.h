@@ -0,0 +1,56 @@
+#pragma once
+
+#include "ClamirFrame.h"
+#include "MeltPoolMask.h"
+#include "RoiGeometry.h"
+#include "ClamirExport.h"
+
+/**
+@class RoiMaskCache
+@brief Host copy of the device ROI as a bitmask, a byte mask and a pixel index list
+
+*The masks are rebuilt only when the settings change, so per-frame analytics get the pixels of RoiContains without any geometry. With rounding enabled these are the assumed shape of RoiGeometry.h, not a verified copy of the device ROI.
+*The byte mask is the ROI argument of MeltPoolMetrics::Compute, the bitmask intersects a MeltPoolMask, and the index list serves sparse loops over the ROI pixels.
+*When the ROI is disabled every pixel is included.
+*/
+class CLAMIRLIBRARY_API RoiMaskCache
+{
+public:
+	RoiMaskCache();
+
+	/**
+	@brief Rebuilds the masks if the settings differ from the cached ones
+	@returns true if the masks were rebuilt
+	*/
+	bool Update(const RoiSettings& settings);
+
+	/**
+	@brief Reads the ROI settings through the cached ClamirFunctions getters and updates the masks
+	*The device is read only when the cache is empty, under the command channel, so it can be called from any thread.
+	@returns 0 on success, or the error code of the failed call
+	*/
+	int Refresh();
+
+	const RoiSettings& Settings() const { return settings; }
+	bool Enabled() const { return settings.Enable != 0; }
+
+	/**
+	@brief Incremented each time the masks are rebuilt, so callers can tell when derived data is stale
+	*/
+	uint32_t Version() const { return version; }
+
+	const MeltPoolMask& Mask() const { return mask; }
+	const uint8_t* Bytes() const { return bytes; }
+	const uint16_t* Indices() const { return indices; }
+	int IndexCount() const { return indexCount; }
+
+private:
+	void Rebuild();
+
+	RoiSettings settings;
+	uint32_t version;
+	MeltPoolMask mask;
+	uint8_t bytes[CLAMIR_IMAGE_PIXELS];
+	uint16_t indices[CLAMIR_IMAGE_PIXELS];
+	int indexCount;
+};
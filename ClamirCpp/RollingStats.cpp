@@ -0,0 +1,110 @@
+#include "pch.h"
+#include "RollingStats.h"
+#include "ClamirFunctions.h"
+
+namespace
+{
+	inline int Wrap(int position)
+	{
+		return position & (CLAMIR_MAX_WINDOW - 1);
+	}
+}
+
+RollingStats::RollingStats(int field, int window) : field(field), window(CLAMIR_MIN_WINDOW)
+{
+	Reset();
+	SetWindow(window);
+}
+
+void RollingStats::Reset()
+{
+	first = count = 0;
+	mean = squares = 0.0;
+	minimumHead = minimumCount = maximumHead = maximumCount = 0;
+}
+
+void RollingStats::SetWindow(int newWindow)
+{
+	newWindow = newWindow < CLAMIR_MIN_WINDOW ? CLAMIR_MIN_WINDOW : newWindow > CLAMIR_MAX_WINDOW ? CLAMIR_MAX_WINDOW : newWindow;
+	while (count > newWindow)
+		Evict();
+	window = newWindow;
+}
+
+int RollingStats::Refresh()
+{
+	int16_t size;
+	int result = ClamirFunctions::CircularBufferSizeGet(&size);
+	if (result == 0)
+		SetWindow(size);
+	return result;
+}
+
+void RollingStats::Add(double value)
+{
+	if (count == window)
+		Evict();
+
+	int position = Wrap(first + count);
+	values[position] = value;
+	count++;
+	// Welford update for the entering sample
+	double delta = value - mean;
+	mean += delta / count;
+	squares += delta * (value - mean);
+
+	while (minimumCount && values[minimum[Wrap(minimumHead + minimumCount - 1)]] >= value)
+		minimumCount--;
+	minimum[Wrap(minimumHead + minimumCount++)] = (uint16_t)position;
+	while (maximumCount && values[maximum[Wrap(maximumHead + maximumCount - 1)]] <= value)
+		maximumCount--;
+	maximum[Wrap(maximumHead + maximumCount++)] = (uint16_t)position;
+
+	if (position == CLAMIR_MAX_WINDOW - 1)
+		Recompute();
+}
+
+void RollingStats::Evict()
+{
+	double value = values[first];
+	if (count == 1)
+	{
+		mean = squares = 0.0;
+	}
+	else
+	{
+		// Welford update run backwards for the leaving sample
+		double delta = value - mean;
+		mean -= delta / (count - 1);
+		squares -= delta * (value - mean);
+		if (squares < 0.0)
+			squares = 0.0;
+	}
+
+	if (minimumCount && minimum[minimumHead] == first)
+	{
+		minimumHead = Wrap(minimumHead + 1);
+		minimumCount--;
+	}
+	if (maximumCount && maximum[maximumHead] == first)
+	{
+		maximumHead = Wrap(maximumHead + 1);
+		maximumCount--;
+	}
+	first = Wrap(first + 1);
+	count--;
+}
+
+void RollingStats::Recompute()
+{
+	double sum = 0.0;
+	for (int i = 0; i < count; i++)
+		sum += values[Wrap(first + i)];
+	mean = sum / count;
+	squares = 0.0;
+	for (int i = 0; i < count; i++)
+	{
+		double delta = values[Wrap(first + i)] - mean;
+		squares += delta * delta;
+	}
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "ClamirFrame.h"
+#include "ClamirExport.h"
+
+// Bounds of CircularBufferSizeSet. The maximum must stay a power of two, the ring positions are wrapped with a mask
+#define CLAMIR_MIN_WINDOW 1
+#define CLAMIR_MAX_WINDOW 512
+
+enum HeaderField
+{
+	HEADER_POWER = 0,
+	HEADER_MELT_POOL_AREA,
+	HEADER_TRACK_NUM,
+	HEADER_FRAME_MAX,
+	HEADER_FRAME_NUM,
+	HEADER_WIDTH,
+	HEADER_REF_WIDTH,
+	HEADER_TEMPERATURE,
+	HEADER_LASER_STATUS,
+	HEADER_STATE_MACHINE,
+	HEADER_IO_DIGITAL_PORT_STATUS,
+	HEADER_FIELDS
+};
+
+/**
+@brief Value of one ImageHeader field
+@param field One of the HeaderField values
+*/
+inline double HeaderFieldValue(const ImageHeader& header, int field)
+{
+	switch (field)
+	{
+	case HEADER_POWER: return header.Power;
+	case HEADER_MELT_POOL_AREA: return header.MeltPoolArea;
+	case HEADER_TRACK_NUM: return header.TrackNum;
+	case HEADER_FRAME_MAX: return header.FrameMax;
+	case HEADER_FRAME_NUM: return header.FrameNum;
+	case HEADER_WIDTH: return header.Width;
+	case HEADER_REF_WIDTH: return header.RefWidth;
+	case HEADER_TEMPERATURE: return header.Temperature;
+	case HEADER_LASER_STATUS: return header.LaserStatus;
+	case HEADER_STATE_MACHINE: return header.StateMachine;
+	case HEADER_IO_DIGITAL_PORT_STATUS: return header.IODigitalPortStatus;
+	default: return 0.0;
+	}
+}
+
+/**
+@class RollingStats
+@brief Mean, variance, minimum and maximum of the last frames of one header field, as the device averages the width over its circular buffer
+
+*Each Add is O(1) amortized: the mean and the sum of squared deviations are updated for the sample that enters and the one that leaves, and the minimum and maximum are the fronts of monotonic deques.
+*The sums are recomputed from the window every time the buffer wraps, so rounding does not accumulate over a long capture.
+*The window follows CircularBufferSizeSet through Refresh. A smaller window keeps the most recent samples.
+*/
+class CLAMIRLIBRARY_API RollingStats
+{
+public:
+	/**
+	@param field HeaderField added by Add(const ImageHeader&)
+	@param window Number of samples, clamped to CLAMIR_MIN_WINDOW..CLAMIR_MAX_WINDOW
+	*/
+	explicit RollingStats(int field = HEADER_WIDTH, int window = 4);
+
+	void Add(const ImageHeader& header) { Add(HeaderFieldValue(header, field)); }
+	void Add(double value);
+	void Reset();
+
+	/**
+	@brief Changes the number of samples, keeping the most recent ones
+	*/
+	void SetWindow(int window);
+
+	/**
+	@brief Reads CircularBufferSizeGet from the device and resizes the window to it
+	@returns 0 on success, or the error code of CircularBufferSizeGet
+	*/
+	int Refresh();
+
+	int Field() const { return field; }
+	int Window() const { return window; }
+	int Count() const { return count; }
+	bool Full() const { return count == window; }
+
+	// All four are 0 while the window is empty
+	double Mean() const { return mean; }
+	// Sample variance, 0 with fewer than two samples
+	double Variance() const { return count > 1 ? squares / (count - 1) : 0.0; }
+	double Min() const { return count ? values[minimum[minimumHead]] : 0.0; }
+	double Max() const { return count ? values[maximum[maximumHead]] : 0.0; }
+
+private:
+	void Evict();
+	void Recompute();
+
+	int field;
+	int window;
+	// Ring of the last samples: the oldest is at first, the newest at (first + count - 1) % CLAMIR_MAX_WINDOW
+	double values[CLAMIR_MAX_WINDOW];
+	int first, count;
+	double mean, squares;
+	// Rings of positions in values with increasing (minimum) or decreasing (maximum) values from head to tail
+	uint16_t minimum[CLAMIR_MAX_WINDOW], maximum[CLAMIR_MAX_WINDOW];
+	int minimumHead, minimumCount, maximumHead, maximumCount;
+};
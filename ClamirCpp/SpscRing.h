@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <new>
+#include <stddef.h>
+#include "ClamirFrame.h"
+
+/**
+@class SpscRing
+@brief Fixed-capacity, lock-free single-producer/single-consumer ring
+
+*Slots are written and read in place: the producer fills the slot returned by BeginWrite and publishes it with CommitWrite, the consumer reads Front and hands it back with Pop.
+*The producer and consumer indices live on separate cache lines, and each side keeps a private copy of the other's index so the shared lines are only touched when the ring looks full or empty.
+*/
+template <typename T>
+class SpscRing
+{
+public:
+	explicit SpscRing(size_t capacity)
+		: head(0), cachedTail(0), tail(0), cachedHead(0), slots(0), mask(0)
+	{
+		size_t rounded = 1;
+		while (rounded < capacity)
+			rounded <<= 1;
+		mask = rounded - 1;
+		slots = static_cast<T*>(ClamirAlignedAlloc(rounded * sizeof(T), CLAMIR_CACHE_LINE));
+		if (!slots)
+			throw std::bad_alloc();
+		for (size_t i = 0; i < rounded; i++)
+			new (&slots[i]) T();
+	}
+
+	~SpscRing()
+	{
+		for (size_t i = 0; i <= mask; i++)
+			slots[i].~T();
+		ClamirAlignedFree(slots);
+	}
+
+	SpscRing(const SpscRing&) = delete;
+	SpscRing& operator=(const SpscRing&) = delete;
+
+	/**
+	@brief Producer side. Returns the next free slot, or a null pointer if the ring is full
+	*/
+	T* BeginWrite()
+	{
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h - cachedTail > mask)
+		{
+			cachedTail = tail.load(std::memory_order_acquire);
+			if (h - cachedTail > mask)
+				return 0;
+		}
+		return &slots[h & mask];
+	}
+
+	/**
+	@brief Producer side. Publishes the slot returned by the last BeginWrite
+	*/
+	void CommitWrite()
+	{
+		head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	/**
+	@brief Consumer side. Returns the oldest published slot, or a null pointer if the ring is empty
+	*/
+	T* Front()
+	{
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (t == cachedHead)
+		{
+			cachedHead = head.load(std::memory_order_acquire);
+			if (t == cachedHead)
+				return 0;
+		}
+		return &slots[t & mask];
+	}
+
+	/**
+	@brief Consumer side. Releases the slot returned by the last Front back to the producer
+	*/
+	void Pop()
+	{
+		tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	/**
+	@brief Number of published slots not yet popped. Safe to call from any thread, the value is a snapshot
+	*/
+	size_t Size() const
+	{
+		size_t t = tail.load(std::memory_order_acquire);
+		size_t h = head.load(std::memory_order_acquire);
+		return h - t;
+	}
+
+	size_t Capacity() const
+	{
+		return mask + 1;
+	}
+
+private:
+	// Producer-owned line
+	std::atomic<size_t> head;
+	size_t cachedTail;
+	char producerPad[CLAMIR_CACHE_LINE];
+
+	// Consumer-owned line
+	std::atomic<size_t> tail;
+	size_t cachedHead;
+	char consumerPad[CLAMIR_CACHE_LINE];
+
+	T* slots;
+	size_t mask;
+};
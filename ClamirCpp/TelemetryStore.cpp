@@ -0,0 +1,522 @@
+#include "pch.h"
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include "TelemetryStore.h"
+
+namespace
+{
+	// LEB128 varint of a 32 bit value takes at most 5 bytes
+	const size_t max_varint_bytes = 5;
+
+	// Mapped window of the writer and the reader, about 25 full chunks
+	const uint64_t view_bytes = 4ull << 20;
+
+	// Chunks start on 8 bytes, so their headers and the directory can be read in place
+	uint64_t PaddedPayload(uint32_t payloadBytes)
+	{
+		return (payloadBytes + 7u) & ~7ull;
+	}
+
+	bool IsFloatColumn(int column)
+	{
+		return column == TELEMETRY_WIDTH || column == TELEMETRY_REF_WIDTH || column == TELEMETRY_TEMPERATURE;
+	}
+
+	uint32_t FloatBits(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	float BitsFloat(uint32_t bits)
+	{
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	double ColumnValue(int column, uint32_t stored)
+	{
+		return IsFloatColumn(column) ? (double)BitsFloat(stored) : (double)(int32_t)stored;
+	}
+
+	uint8_t* PutVarint(uint32_t value, uint8_t* out)
+	{
+		while (value >= 0x80)
+		{
+			*out++ = (uint8_t)(value | 0x80);
+			value >>= 7;
+		}
+		*out++ = (uint8_t)value;
+		return out;
+	}
+
+	const uint8_t* GetVarint(const uint8_t* in, const uint8_t* end, uint32_t* value)
+	{
+		uint32_t result = 0;
+		for (int shift = 0; shift < 35 && in < end; shift += 7)
+		{
+			uint8_t byte = *in++;
+			result |= (uint32_t)(byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+			{
+				*value = result;
+				return in;
+			}
+		}
+		return 0;
+	}
+
+	// Range of Value + Scale * OtherColumn over a chunk
+	void ConditionRange(const TelemetryCondition& condition, const TelemetryChunkHeader& chunk, double* low, double* high)
+	{
+		if (condition.OtherColumn < 0)
+		{
+			*low = *high = condition.Value;
+			return;
+		}
+		double a = condition.Value + condition.Scale * chunk.Columns[condition.OtherColumn].Min;
+		double b = condition.Value + condition.Scale * chunk.Columns[condition.OtherColumn].Max;
+		*low = a < b ? a : b;
+		*high = a < b ? b : a;
+	}
+
+	// True when the min/max of the chunk show that no row can satisfy the condition
+	bool CannotMatch(const TelemetryCondition& condition, const TelemetryChunkHeader& chunk)
+	{
+		const TelemetryColumnChunk& column = chunk.Columns[condition.Column];
+		double low, high;
+		ConditionRange(condition, chunk, &low, &high);
+		switch (condition.Operator)
+		{
+		case TELEMETRY_LT:
+			return column.Min >= high;
+		case TELEMETRY_LE:
+			return column.Min > high;
+		case TELEMETRY_GT:
+			return column.Max <= low;
+		case TELEMETRY_GE:
+			return column.Max < low;
+		case TELEMETRY_EQ:
+			return column.Max < low || column.Min > high;
+		default:
+			return column.Min == column.Max && low == high && column.Min == low;
+		}
+	}
+
+	bool Compare(int op, double value, double reference)
+	{
+		switch (op)
+		{
+		case TELEMETRY_LT:
+			return value < reference;
+		case TELEMETRY_LE:
+			return value <= reference;
+		case TELEMETRY_GT:
+			return value > reference;
+		case TELEMETRY_GE:
+			return value >= reference;
+		case TELEMETRY_EQ:
+			return value == reference;
+		default:
+			return value != reference;
+		}
+	}
+}
+
+TelemetryWriter::TelemetryWriter() : rowCount(0), stagedRows(0), failed(false)
+{
+}
+
+TelemetryWriter::~TelemetryWriter()
+{
+	Close();
+}
+
+int TelemetryWriter::Open(const char* path)
+{
+	Close();
+	if (!file.Create(path, view_bytes, view_bytes))
+		return -1;
+
+	rowCount = 0;
+	stagedRows = 0;
+	staged.resize(TELEMETRY_COLUMNS * CLAMIR_TELEMETRY_CHUNK_ROWS);
+	encoded.resize(TELEMETRY_COLUMNS * CLAMIR_TELEMETRY_CHUNK_ROWS * max_varint_bytes);
+	directory.clear();
+	failed = false;
+
+	TelemetryFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.Magic, CLAMIR_TELEMETRY_MAGIC, sizeof(header.Magic));
+	header.Version = CLAMIR_TELEMETRY_VERSION;
+	header.Columns = TELEMETRY_COLUMNS;
+	header.ChunkRows = CLAMIR_TELEMETRY_CHUNK_ROWS;
+	if (!file.Write(&header, sizeof(header)))
+	{
+		failed = true;
+		return -1;
+	}
+	return 0;
+}
+
+int TelemetryWriter::Append(const ImageHeader& header)
+{
+	if (!file.IsOpen())
+		return -2;
+	if (failed)
+		return -1;
+
+	uint32_t* row = staged.data() + stagedRows;
+	row[TELEMETRY_POWER * CLAMIR_TELEMETRY_CHUNK_ROWS] = (uint32_t)header.Power;
+	row[TELEMETRY_MELT_POOL_AREA * CLAMIR_TELEMETRY_CHUNK_ROWS] = (uint32_t)header.MeltPoolArea;
+	row[TELEMETRY_WIDTH * CLAMIR_TELEMETRY_CHUNK_ROWS] = FloatBits(header.Width);
+	row[TELEMETRY_REF_WIDTH * CLAMIR_TELEMETRY_CHUNK_ROWS] = FloatBits(header.RefWidth);
+	row[TELEMETRY_TEMPERATURE * CLAMIR_TELEMETRY_CHUNK_ROWS] = FloatBits(header.Temperature);
+	row[TELEMETRY_TRACK_NUM * CLAMIR_TELEMETRY_CHUNK_ROWS] = (uint32_t)header.TrackNum;
+	row[TELEMETRY_STATE_MACHINE * CLAMIR_TELEMETRY_CHUNK_ROWS] = (uint32_t)(int32_t)header.StateMachine;
+	row[TELEMETRY_IO_DIGITAL_PORT_STATUS * CLAMIR_TELEMETRY_CHUNK_ROWS] = (uint32_t)(int32_t)header.IODigitalPortStatus;
+	stagedRows++;
+	rowCount++;
+
+	if (stagedRows == CLAMIR_TELEMETRY_CHUNK_ROWS)
+		return FlushChunk();
+	return 0;
+}
+
+int TelemetryWriter::FlushChunk()
+{
+	if (stagedRows == 0)
+		return 0;
+
+	TelemetryChunkHeader chunk;
+	memset(&chunk, 0, sizeof(chunk));
+	chunk.Rows = stagedRows;
+
+	uint8_t* out = encoded.data();
+	for (int c = 0; c < TELEMETRY_COLUMNS; c++)
+	{
+		const uint32_t* values = staged.data() + c * CLAMIR_TELEMETRY_CHUNK_ROWS;
+		uint8_t* start = out;
+		double low = HUGE_VAL, high = -HUGE_VAL;
+		uint32_t previous = 0;
+		bool isFloat = IsFloatColumn(c);
+		for (uint32_t i = 0; i < stagedRows; i++)
+		{
+			uint32_t value = values[i];
+			double number = ColumnValue(c, value);
+			// NaN never satisfies an ordered comparison, so it is left out of the bounds
+			if (number < low)
+				low = number;
+			if (number > high)
+				high = number;
+			if (isFloat)
+				out = PutVarint(value ^ previous, out);
+			else
+			{
+				uint32_t delta = value - previous;
+				out = PutVarint((delta << 1) ^ (uint32_t)((int32_t)delta >> 31), out);
+			}
+			previous = value;
+		}
+		chunk.Columns[c].Bytes = (uint32_t)(out - start);
+		chunk.Columns[c].Min = low;
+		chunk.Columns[c].Max = high;
+	}
+	chunk.PayloadBytes = (uint32_t)(out - encoded.data());
+	while (out - encoded.data() < (ptrdiff_t)PaddedPayload(chunk.PayloadBytes))
+		*out++ = 0;
+
+	uint64_t offset = file.Offset();
+	if (!file.Write(&chunk, sizeof(chunk)) || !file.Write(encoded.data(), (size_t)(out - encoded.data())))
+	{
+		failed = true;
+		return -1;
+	}
+	directory.push_back(offset);
+	stagedRows = 0;
+	return 0;
+}
+
+int TelemetryWriter::Close()
+{
+	if (!file.IsOpen())
+		return -2;
+
+	int result = failed ? -1 : FlushChunk();
+	if (result == 0)
+	{
+		TelemetryFooter footer;
+		memset(&footer, 0, sizeof(footer));
+		memcpy(footer.Magic, CLAMIR_TELEMETRY_FOOTER_MAGIC, sizeof(footer.Magic));
+		footer.ChunkCount = directory.size();
+		footer.DirectoryOffset = file.Offset();
+		footer.RowCount = rowCount;
+		if ((!directory.empty() && !file.Write(directory.data(), directory.size() * sizeof(uint64_t))) || !file.Write(&footer, sizeof(footer)))
+			result = -1;
+	}
+	// Trims the preallocation
+	if (!file.Close() && result == 0)
+		result = -1;
+	directory.clear();
+	return result;
+}
+
+TelemetryStore::TelemetryStore() : dataSize(0), rowCount(0)
+{
+}
+
+TelemetryStore::~TelemetryStore()
+{
+	Close();
+}
+
+int TelemetryStore::Open(const char* path)
+{
+	Close();
+	if (!file.Open(path))
+		return -1;
+	dataSize = file.Size();
+	if (dataSize < sizeof(TelemetryFileHeader))
+	{
+		Close();
+		return -2;
+	}
+	const char* start = file.View(0, sizeof(TelemetryFileHeader), (size_t)view_bytes);
+	if (!start)
+	{
+		Close();
+		return -1;
+	}
+
+	TelemetryFileHeader header;
+	memcpy(&header, start, sizeof(header));
+	if (memcmp(header.Magic, CLAMIR_TELEMETRY_MAGIC, sizeof(header.Magic)) != 0 || header.Version > CLAMIR_TELEMETRY_VERSION || header.Columns != TELEMETRY_COLUMNS)
+	{
+		Close();
+		return -2;
+	}
+
+	TelemetryFooter footer;
+	memset(&footer, 0, sizeof(footer));
+	if (dataSize >= sizeof(TelemetryFileHeader) + sizeof(TelemetryFooter))
+	{
+		const char* end = file.View(dataSize - sizeof(TelemetryFooter), sizeof(TelemetryFooter), sizeof(TelemetryFooter));
+		if (!end)
+		{
+			Close();
+			return -1;
+		}
+		memcpy(&footer, end, sizeof(footer));
+	}
+	if (memcmp(footer.Magic, CLAMIR_TELEMETRY_FOOTER_MAGIC, sizeof(footer.Magic)) == 0 && footer.ChunkCount <= dataSize / sizeof(uint64_t) &&
+		footer.DirectoryOffset + footer.ChunkCount * sizeof(uint64_t) <= dataSize - sizeof(TelemetryFooter))
+	{
+		chunks.resize((size_t)footer.ChunkCount);
+		if (!chunks.empty())
+		{
+			// Copied before the chunk headers move the view
+			const char* directory = file.View(footer.DirectoryOffset, chunks.size() * sizeof(uint64_t), (size_t)view_bytes);
+			if (!directory)
+			{
+				Close();
+				return -1;
+			}
+			memcpy(chunks.data(), directory, chunks.size() * sizeof(uint64_t));
+		}
+		uint64_t row = 0;
+		for (uint64_t i = 0; i < footer.ChunkCount; i++)
+		{
+			chunkFirstRow.push_back(row);
+			const TelemetryChunkHeader* chunk = Chunk(i);
+			if (!chunk)
+			{
+				Close();
+				return -2;
+			}
+			row += chunk->Rows;
+		}
+		rowCount = row;
+		return 0;
+	}
+
+	// No footer: the writer did not close the file. Recover the complete chunks
+	if (!ScanChunks())
+	{
+		Close();
+		return -1;
+	}
+	return 0;
+}
+
+bool TelemetryStore::ScanChunks()
+{
+	uint64_t offset = sizeof(TelemetryFileHeader);
+	uint64_t row = 0;
+	while (offset + sizeof(TelemetryChunkHeader) <= dataSize)
+	{
+		const TelemetryChunkHeader* chunk = (const TelemetryChunkHeader*)file.View(offset, sizeof(TelemetryChunkHeader), (size_t)view_bytes);
+		if (!chunk)
+			return false;
+		uint64_t next = offset + sizeof(TelemetryChunkHeader) + PaddedPayload(chunk->PayloadBytes);
+		if (chunk->Rows == 0 || chunk->Rows > CLAMIR_TELEMETRY_CHUNK_ROWS || next > dataSize)
+			break;
+		chunks.push_back(offset);
+		chunkFirstRow.push_back(row);
+		row += chunk->Rows;
+		offset = next;
+	}
+	rowCount = row;
+	return true;
+}
+
+void TelemetryStore::Close()
+{
+	file.Close();
+	dataSize = 0;
+	chunks.clear();
+	chunkFirstRow.clear();
+	rowCount = 0;
+}
+
+const TelemetryChunkHeader* TelemetryStore::Chunk(uint64_t i) const
+{
+	if (i >= chunks.size())
+		return 0;
+	uint64_t offset = chunks[i];
+	if (offset % 8 != 0 || offset > dataSize || dataSize - offset < sizeof(TelemetryChunkHeader))
+		return 0;
+	const TelemetryChunkHeader* chunk = (const TelemetryChunkHeader*)file.View(offset, sizeof(TelemetryChunkHeader), (size_t)view_bytes);
+	if (!chunk || chunk->Rows > CLAMIR_TELEMETRY_CHUNK_ROWS || chunk->PayloadBytes > dataSize - offset - sizeof(TelemetryChunkHeader))
+		return 0;
+	// Maps the whole chunk, so that the header stays valid while its columns are decoded
+	return (const TelemetryChunkHeader*)file.View(offset, sizeof(TelemetryChunkHeader) + chunk->PayloadBytes, (size_t)view_bytes);
+}
+
+bool TelemetryStore::DecodeColumn(uint64_t i, int column, double* values) const
+{
+	const TelemetryChunkHeader* chunk = Chunk(i);
+	if (!chunk)
+		return false;
+
+	const uint8_t* in = (const uint8_t*)(chunk + 1);
+	for (int c = 0; c < column; c++)
+		in += chunk->Columns[c].Bytes;
+	const uint8_t* end = in + chunk->Columns[column].Bytes;
+	if (end > (const uint8_t*)(chunk + 1) + chunk->PayloadBytes)
+		return false;
+
+	uint32_t previous = 0;
+	bool isFloat = IsFloatColumn(column);
+	for (uint32_t r = 0; r < chunk->Rows; r++)
+	{
+		uint32_t code;
+		in = GetVarint(in, end, &code);
+		if (!in)
+			return false;
+		if (isFloat)
+			previous ^= code;
+		else
+			previous += (code >> 1) ^ (0 - (code & 1));
+		values[r] = ColumnValue(column, previous);
+	}
+	return true;
+}
+
+int TelemetryStore::ReadColumn(int column, uint64_t first, uint64_t count, double* values) const
+{
+	if (column < 0 || column >= TELEMETRY_COLUMNS || first > rowCount || count > rowCount - first)
+		return -1;
+	if (count == 0)
+		return 0;
+
+	std::vector<double> decoded(CLAMIR_TELEMETRY_CHUNK_ROWS);
+	uint64_t i = (uint64_t)(std::upper_bound(chunkFirstRow.begin(), chunkFirstRow.end(), first) - chunkFirstRow.begin()) - 1;
+	uint64_t row = first;
+	while (count > 0)
+	{
+		if (!DecodeColumn(i, column, decoded.data()))
+			return -2;
+		uint64_t start = row - chunkFirstRow[i];
+		uint64_t n = Chunk(i)->Rows - start;
+		if (n > count)
+			n = count;
+		memcpy(values, decoded.data() + start, (size_t)n * sizeof(double));
+		values += n;
+		row += n;
+		count -= n;
+		i++;
+	}
+	return 0;
+}
+
+int TelemetryStore::Query(const TelemetryCondition* conditions, int count, std::vector<uint64_t>* rows, uint64_t* chunksRead) const
+{
+	for (int k = 0; k < count; k++)
+	{
+		const TelemetryCondition& condition = conditions[k];
+		if (condition.Column < 0 || condition.Column >= TELEMETRY_COLUMNS || condition.OtherColumn < -1 || condition.OtherColumn >= TELEMETRY_COLUMNS ||
+			condition.Operator < TELEMETRY_LT || condition.Operator > TELEMETRY_NE)
+			return -1;
+	}
+
+	rows->clear();
+	if (chunksRead)
+		*chunksRead = 0;
+
+	// Columns are decoded at most once per chunk, and only when a condition needs them
+	std::vector<double> columns(TELEMETRY_COLUMNS * CLAMIR_TELEMETRY_CHUNK_ROWS);
+	std::vector<uint8_t> selected(CLAMIR_TELEMETRY_CHUNK_ROWS);
+	for (uint64_t i = 0; i < chunks.size(); i++)
+	{
+		const TelemetryChunkHeader* chunk = Chunk(i);
+		if (!chunk)
+			return -2;
+
+		bool skip = false;
+		for (int k = 0; k < count && !skip; k++)
+			skip = CannotMatch(conditions[k], *chunk);
+		if (skip)
+			continue;
+		if (chunksRead)
+			(*chunksRead)++;
+
+		uint32_t n = chunk->Rows;
+		bool decoded[TELEMETRY_COLUMNS] = {};
+		memset(selected.data(), 1, n);
+		for (int k = 0; k < count; k++)
+		{
+			const TelemetryCondition& condition = conditions[k];
+			int needed[2] = { condition.Column, condition.OtherColumn };
+			for (int c : needed)
+			{
+				if (c >= 0 && !decoded[c])
+				{
+					if (!DecodeColumn(i, c, columns.data() + c * CLAMIR_TELEMETRY_CHUNK_ROWS))
+						return -2;
+					decoded[c] = true;
+				}
+			}
+
+			const double* values = columns.data() + condition.Column * CLAMIR_TELEMETRY_CHUNK_ROWS;
+			if (condition.OtherColumn < 0)
+			{
+				for (uint32_t r = 0; r < n; r++)
+					selected[r] &= (uint8_t)Compare(condition.Operator, values[r], condition.Value);
+			}
+			else
+			{
+				const double* other = columns.data() + condition.OtherColumn * CLAMIR_TELEMETRY_CHUNK_ROWS;
+				for (uint32_t r = 0; r < n; r++)
+					selected[r] &= (uint8_t)Compare(condition.Operator, values[r], condition.Value + condition.Scale * other[r]);
+			}
+		}
+
+		for (uint32_t r = 0; r < n; r++)
+			if (selected[r])
+				rows->push_back(chunkFirstRow[i] + r);
+	}
+	return 0;
+}
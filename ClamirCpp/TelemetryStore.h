@@ -0,0 +1,214 @@
+#pragma once
+
+#include <stdio.h>
+#include <vector>
+#include "ClamirFrame.h"
+#include "MappedFile.h"
+#include "ClamirExport.h"
+
+/**
+*Telemetry file layout, all integers little endian:
+*- TelemetryFileHeader (24 bytes)
+*- One chunk per CLAMIR_TELEMETRY_CHUNK_ROWS frames: a TelemetryChunkHeader holding the size and the min/max of every column, followed by the encoded columns in TelemetryColumn order, padded to 8 bytes
+*- The chunk directory: one uint64_t file offset per chunk
+*- TelemetryFooter (32 bytes), which locates the directory
+*Integer columns are stored as zigzag mapped deltas, float columns as the XOR of consecutive bit patterns, both as LEB128 varints.
+*Row i of the store is frame i of the capture it was written with.
+*/
+#define CLAMIR_TELEMETRY_MAGIC "CLMRTEL1"
+#define CLAMIR_TELEMETRY_FOOTER_MAGIC "CLMRTDX1"
+#define CLAMIR_TELEMETRY_VERSION 1
+#define CLAMIR_TELEMETRY_CHUNK_ROWS 4096
+
+enum TelemetryColumn
+{
+	TELEMETRY_POWER = 0,
+	TELEMETRY_MELT_POOL_AREA,
+	TELEMETRY_WIDTH,
+	TELEMETRY_REF_WIDTH,
+	TELEMETRY_TEMPERATURE,
+	TELEMETRY_TRACK_NUM,
+	TELEMETRY_STATE_MACHINE,
+	TELEMETRY_IO_DIGITAL_PORT_STATUS,
+	TELEMETRY_COLUMNS
+};
+
+enum TelemetryOperator
+{
+	TELEMETRY_LT = 0,
+	TELEMETRY_LE,
+	TELEMETRY_GT,
+	TELEMETRY_GE,
+	TELEMETRY_EQ,
+	TELEMETRY_NE
+};
+
+struct TelemetryFileHeader
+{
+	char Magic[8];
+	uint32_t Version, Columns, ChunkRows, Reserved;
+};
+
+struct TelemetryColumnChunk
+{
+	uint32_t Bytes, Reserved;
+	double Min, Max;
+};
+
+struct TelemetryChunkHeader
+{
+	uint32_t Rows, PayloadBytes;
+	TelemetryColumnChunk Columns[TELEMETRY_COLUMNS];
+};
+
+struct TelemetryFooter
+{
+	char Magic[8];
+	uint64_t ChunkCount, DirectoryOffset, RowCount;
+};
+
+/**
+@brief One term of a query: Column Operator Value + Scale * OtherColumn, or Column Operator Value when OtherColumn is -1
+*/
+struct TelemetryCondition
+{
+	int Column;
+	int Operator;
+	double Value;
+	int OtherColumn;
+	double Scale;
+};
+
+/**
+@brief Condition comparing a column with a constant, e.g. StateMachine == CLAMIR_STATE_CONTROL
+*/
+inline TelemetryCondition TelemetryCompare(int column, int op, double value)
+{
+	TelemetryCondition condition = { column, op, value, -1, 0.0 };
+	return condition;
+}
+
+/**
+@brief Condition comparing a column with a scaled column, e.g. Width > RefWidth * 1.2
+*/
+inline TelemetryCondition TelemetryCompareColumns(int column, int op, int otherColumn, double scale, double offset = 0.0)
+{
+	TelemetryCondition condition = { column, op, offset, otherColumn, scale };
+	return condition;
+}
+
+/**
+@class TelemetryWriter
+@brief Append-only writer of the columnar telemetry of a capture
+
+*Rows are staged in memory and encoded one chunk at a time, so Append only stores eight values. Chunks are written through a MappedWriter, so the chunk that completes never waits on a write call either.
+*/
+class CLAMIRLIBRARY_API TelemetryWriter
+{
+public:
+	TelemetryWriter();
+	~TelemetryWriter();
+
+	TelemetryWriter(const TelemetryWriter&) = delete;
+	TelemetryWriter& operator=(const TelemetryWriter&) = delete;
+
+	/**
+	@returns 0 on success
+	@returns -1 if the file cannot be created
+	*/
+	int Open(const char* path);
+
+	/**
+	@brief Appends the telemetry of one frame
+	@returns 0 on success
+	@returns -1 on a file error
+	@returns -2 if the writer is not open
+	*/
+	int Append(const ImageHeader& header);
+
+	/**
+	@brief Writes the last chunk, the directory and the footer and closes the file
+	@returns 0 on success
+	@returns -1 on a file error
+	@returns -2 if the writer is not open
+	*/
+	int Close();
+
+	bool IsOpen() const { return file.IsOpen(); }
+	uint64_t RowCount() const { return rowCount; }
+
+private:
+	int FlushChunk();
+
+	MappedWriter file;
+	uint64_t rowCount;
+	uint32_t stagedRows;
+	std::vector<uint32_t> staged;
+	std::vector<uint8_t> encoded;
+	std::vector<uint64_t> directory;
+	bool failed;
+};
+
+/**
+@class TelemetryStore
+@brief Reader and query engine for telemetry files
+
+*Queries decode only the columns their conditions use, and skip the chunks whose min/max show that no row can match.
+*Chunks are read through a sliding mapped view, so the size of the file does not matter.
+*/
+class CLAMIRLIBRARY_API TelemetryStore
+{
+public:
+	TelemetryStore();
+	~TelemetryStore();
+
+	TelemetryStore(const TelemetryStore&) = delete;
+	TelemetryStore& operator=(const TelemetryStore&) = delete;
+
+	/**
+	@returns 0 on success
+	@returns -1 if the file cannot be opened or mapped
+	@returns -2 if the file is not a telemetry file
+	*/
+	int Open(const char* path);
+	void Close();
+
+	uint64_t RowCount() const { return rowCount; }
+	uint64_t ChunkCount() const { return chunks.size(); }
+
+	/**
+	@brief Returns the header of chunk i, holding the min/max of every column. Its encoded columns follow it
+	*The pointer is valid until another chunk is read.
+	*/
+	const TelemetryChunkHeader* Chunk(uint64_t i) const;
+
+	/**
+	@brief Reads count values of a column starting at row first
+	@returns 0 on success
+	@returns -1 if the column or the rows are out of range
+	@returns -2 if the file is corrupt
+	*/
+	int ReadColumn(int column, uint64_t first, uint64_t count, double* values) const;
+
+	/**
+	@brief Finds the rows matching all the conditions
+	@param conditions Conditions combined with AND
+	@param count Number of conditions. With no condition every row matches
+	@param rows Receives the matching row numbers in increasing order
+	@param chunksRead If not null, receives the number of chunks that were decoded rather than skipped
+	@returns 0 on success
+	@returns -1 if a condition is invalid
+	@returns -2 if the file is corrupt
+	*/
+	int Query(const TelemetryCondition* conditions, int count, std::vector<uint64_t>* rows, uint64_t* chunksRead = 0) const;
+
+private:
+	bool ScanChunks();
+	bool DecodeColumn(uint64_t chunk, int column, double* values) const;
+
+	mutable MappedFile file;
+	uint64_t dataSize;
+	std::vector<uint64_t> chunks;
+	std::vector<uint64_t> chunkFirstRow;
+	uint64_t rowCount;
+};
@@ -0,0 +1,159 @@
+#include "pch.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include "TransitionIndex.h"
+#include "FrameRecorder.h"
+#include "RawHeader.h"
+#include "TelemetryStore.h"
+
+TransitionIndex::TransitionIndex() : frameCount(0)
+{
+}
+
+void TransitionIndex::Clear()
+{
+	transitions.clear();
+	frameCount = 0;
+}
+
+void TransitionIndex::Add(int trackNum, int stateMachine)
+{
+	if (transitions.empty() || transitions.back().TrackNum != trackNum || transitions.back().StateMachine != stateMachine)
+	{
+		Transition transition;
+		transition.Frame = frameCount;
+		transition.TrackNum = trackNum;
+		transition.StateMachine = stateMachine;
+		transitions.push_back(transition);
+	}
+	frameCount++;
+}
+
+int TransitionIndex::Build(const TelemetryStore& telemetry)
+{
+	Clear();
+	std::vector<double> tracks(CLAMIR_TELEMETRY_CHUNK_ROWS), states(CLAMIR_TELEMETRY_CHUNK_ROWS);
+	for (uint64_t i = 0; i < telemetry.ChunkCount(); i++)
+	{
+		const TelemetryChunkHeader* chunk = telemetry.Chunk(i);
+		if (!chunk)
+			return -2;
+
+		const TelemetryColumnChunk& track = chunk->Columns[TELEMETRY_TRACK_NUM];
+		const TelemetryColumnChunk& state = chunk->Columns[TELEMETRY_STATE_MACHINE];
+		if (!transitions.empty() && track.Min == track.Max && state.Min == state.Max &&
+			track.Min == transitions.back().TrackNum && state.Min == transitions.back().StateMachine)
+		{
+			frameCount += chunk->Rows;
+			continue;
+		}
+
+		if (telemetry.ReadColumn(TELEMETRY_TRACK_NUM, frameCount, chunk->Rows, tracks.data()) != 0 ||
+			telemetry.ReadColumn(TELEMETRY_STATE_MACHINE, frameCount, chunk->Rows, states.data()) != 0)
+			return -2;
+		for (uint32_t r = 0; r < chunk->Rows; r++)
+			Add((int)tracks[r], (int)states[r]);
+	}
+	return 0;
+}
+
+int TransitionIndex::Build(const FrameRecording& recording)
+{
+	Clear();
+	for (uint64_t i = 0; i < recording.FrameCount(); i++)
+	{
+		const RecordHeader* record = recording.Record(i);
+		if (!record)
+			return -2;
+		Add(record->RawHeader[RAW_TRACK_NUM], (char)record->RawHeader[RAW_STATE_MACHINE]);
+	}
+	return 0;
+}
+
+int TransitionIndex::Save(const char* path) const
+{
+	FILE* file = fopen(path, "wb");
+	if (!file)
+		return -1;
+
+	TransitionFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.Magic, CLAMIR_TRANSITIONS_MAGIC, sizeof(header.Magic));
+	header.Version = CLAMIR_TRANSITIONS_VERSION;
+	header.FrameCount = frameCount;
+	header.TransitionCount = transitions.size();
+	int result = 0;
+	if (fwrite(&header, sizeof(header), 1, file) != 1 ||
+		(!transitions.empty() && fwrite(transitions.data(), sizeof(Transition), transitions.size(), file) != transitions.size()))
+		result = -1;
+	if (fclose(file) != 0)
+		result = -1;
+	return result;
+}
+
+int TransitionIndex::Load(const char* path)
+{
+	Clear();
+	FILE* file = fopen(path, "rb");
+	if (!file)
+		return -1;
+
+	TransitionFileHeader header;
+	int result = 0;
+	if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.Magic, CLAMIR_TRANSITIONS_MAGIC, sizeof(header.Magic)) != 0 || header.Version > CLAMIR_TRANSITIONS_VERSION)
+		result = -2;
+	else
+	{
+		transitions.resize((size_t)header.TransitionCount);
+		if (!transitions.empty() && fread(transitions.data(), sizeof(Transition), transitions.size(), file) != transitions.size())
+			result = -2;
+		frameCount = header.FrameCount;
+	}
+	fclose(file);
+	if (result != 0)
+		Clear();
+	return result;
+}
+
+long long TransitionIndex::Find(uint64_t frame) const
+{
+	if (frame >= frameCount)
+		return -1;
+	std::vector<Transition>::const_iterator next = std::upper_bound(transitions.begin(), transitions.end(), frame,
+		[](uint64_t value, const Transition& transition) { return value < transition.Frame; });
+	return (long long)(next - transitions.begin()) - 1;
+}
+
+uint64_t TransitionIndex::RunEnd(size_t i) const
+{
+	return i + 1 < transitions.size() ? transitions[i + 1].Frame : frameCount;
+}
+
+bool TransitionIndex::FindTrack(int trackNum, uint64_t* first, uint64_t* end) const
+{
+	bool found = false;
+	for (size_t i = 0; i < transitions.size(); i++)
+	{
+		if (transitions[i].TrackNum != trackNum)
+			continue;
+		if (!found)
+			*first = transitions[i].Frame;
+		*end = RunEnd(i);
+		found = true;
+	}
+	return found;
+}
+
+long long TransitionIndex::FindState(int stateMachine, uint64_t from) const
+{
+	long long i = Find(from);
+	if (i < 0)
+		return -1;
+	for (size_t j = (size_t)i; j < transitions.size(); j++)
+	{
+		if (transitions[j].StateMachine == stateMachine)
+			return (long long)(j == (size_t)i ? from : transitions[j].Frame);
+	}
+	return -1;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <vector>
+#include "ClamirFrame.h"
+#include "ClamirExport.h"
+
+class FrameRecording;
+class TelemetryStore;
+
+/**
+*Transition file layout, all integers little endian:
+*- TransitionFileHeader (32 bytes)
+*- One Transition per frame where TrackNum or StateMachine changes, the first frame included
+*/
+#define CLAMIR_TRANSITIONS_MAGIC "CLMRTRN1"
+#define CLAMIR_TRANSITIONS_VERSION 1
+
+struct TransitionFileHeader
+{
+	char Magic[8];
+	uint32_t Version, Reserved;
+	uint64_t FrameCount, TransitionCount;
+};
+
+/**
+@brief First frame of a run of frames sharing the same track and state
+*/
+struct Transition
+{
+	uint64_t Frame;
+	int32_t TrackNum, StateMachine;
+};
+
+/**
+@class TransitionIndex
+@brief Index of the TrackNum and StateMachine changes of a capture
+
+*A capture holds a few transitions per track against thousands of frames, so seeking to a track or a state is a search over this small list instead of a scan of the capture.
+*FrameRecorder writes it next to each capture as capture path + ".transitions". Older captures can be indexed from their telemetry or, failing that, from their record headers.
+*/
+class CLAMIRLIBRARY_API TransitionIndex
+{
+public:
+	TransitionIndex();
+
+	void Clear();
+
+	/**
+	@brief Adds the next frame of the capture. Frames must be added in order
+	*/
+	void Add(int trackNum, int stateMachine);
+
+	/**
+	@brief Builds the index from the TrackNum and StateMachine columns of a telemetry file. Chunks whose min/max show no change are not decoded
+	@returns 0 on success
+	@returns -2 if the telemetry is corrupt
+	*/
+	int Build(const TelemetryStore& telemetry);
+
+	/**
+	@brief Builds the index from the record headers of a capture. Images are not decoded
+	@returns 0 on success
+	@returns -2 if the capture is corrupt
+	*/
+	int Build(const FrameRecording& recording);
+
+	/**
+	@returns 0 on success
+	@returns -1 on a file error
+	*/
+	int Save(const char* path) const;
+
+	/**
+	@returns 0 on success
+	@returns -1 if the file cannot be read
+	@returns -2 if the file is not a transition index
+	*/
+	int Load(const char* path);
+
+	uint64_t FrameCount() const { return frameCount; }
+	size_t TransitionCount() const { return transitions.size(); }
+	const Transition& At(size_t i) const { return transitions[i]; }
+
+	/**
+	@brief Returns the transition in effect at a frame, that is its track and state
+	@returns the position of the transition, or -1 if the frame is out of range
+	*/
+	long long Find(uint64_t frame) const;
+
+	/**
+	@brief Finds the frames of a track
+	@param first Receives the first frame of the track
+	@param end Receives the frame after the last frame of the track
+	@returns true if the track was found. A track recorded in several runs is reported from its first frame to the end of its last run
+	*/
+	bool FindTrack(int trackNum, uint64_t* first, uint64_t* end) const;
+
+	/**
+	@brief Returns the first frame at or after a frame in a state, e.g. CLAMIR_STATE_CONTROL
+	@returns the frame, or -1 if the state does not occur
+	*/
+	long long FindState(int stateMachine, uint64_t from = 0) const;
+
+	/**
+	@brief Returns the frame after the last frame of the run containing transition i
+	*/
+	uint64_t RunEnd(size_t i) const;
+
+private:
+	std::vector<Transition> transitions;
+	uint64_t frameCount;
+};
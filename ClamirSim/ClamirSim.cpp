@@ -0,0 +1,623 @@
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <thread>
+#include "ClamirSim.h"
+#include "ClamirParameters.h"
+#include "RawHeader.h"
+#include "Replay.h"
+#include "RoiGeometry.h"
+
+namespace
+{
+	// Parameters of the simulated device, initialized to the defaults documented in CLAMIR_dll.h
+	struct DeviceParameters
+	{
+		int16_t KI = 500, KP = 200, KD = 100;
+		int16_t MaxPower = 1500, MinPower = 500;
+		int16_t Threshold = 1200, ThresholdToStartTracks = 40, ThresholdToEndTracks = 30;
+		int16_t ManualPower = 1000, Mode = 2;
+		int16_t ReferenceTrackStart = 0, ReferenceTrackEnd = 3;
+		float TrackDuration = 2.0f, ManualReferenceWidthValue = 1.0f;
+		int16_t RoundROI = 0;
+		int EnableROI = 0;
+		int16_t ROIX1 = 2, ROIY1 = 2, ROIX2 = 61, ROIY2 = 61;
+		int16_t PowerLimitMax = 1500, PowerLimitMin = 500;
+		float PixelToMillimeterRatio = 0.015f;
+		int16_t EndOfProcessTime = 5000, LimitIntegral = 5000;
+		float LimitSlewRate = 1.0f;
+		int16_t CircularBufferSize = 4;
+		int EnableAlarm = 0;
+		float AlarmMax = 5.0f, AlarmMin = 1.0f;
+		int16_t AlarmTime = 2000;
+		int Automeasure = 1;
+		int AutoShutterEnable = 0, AutoShutterEnableInProcess = 0, AutoShutterTemperatureDrift = 1, AutoShutterTimer = 0;
+		float AutoshutterDriftTemperature = 3.0f, AutoshutterTimer = 180.0f;
+		int LaserExternal = 0;
+		int16_t LaserONDelay = 0;
+		int EnablePreheating = 0;
+		int16_t PreheatingTime = 0, PreheatingPower = 1500;
+		int DigitalOut[4] = { 0, 0, 0, 0 };
+		int16_t IntegrationTime = 200;
+		float BiasVoltage = 2.0f;
+		int ShutterPosition = 0;
+		int16_t BlackLevel = 1000;
+	};
+
+	// State of the synthetic process, advanced by one step per generated frame
+	struct ProcessState
+	{
+		bool LaserDetected = false;
+		double LaserOnSince = 0;
+		double Power = 0;
+		double Integral = 0;
+		double LastError = 0;
+		double RefWidth = 1.0;
+		double RefWidthSum = 0;
+		int RefWidthCount = 0;
+		double AlarmSince = -1;
+		double WidthBuffer[512];
+		int WidthBufferNext = 0, WidthBufferCount = 0;
+	};
+
+	const int noise_table_size = 1 << 16;
+	const int max_pixel_value = 16383;
+
+	std::mutex device_lock;
+	DeviceParameters parameters;
+	ClamirSimConfig config = { 1000.0f, 0.5f, 2.0f, 8.0f, 1 };
+	bool connected = false;
+	// Cleared by ClamirSimSetLink to emulate an unplugged cable
+	bool link_up = true;
+	bool config_changed = false;
+
+	// Image channel. Only touched by the thread reading images, serialized by image_lock
+	std::mutex image_lock;
+	ProcessState process;
+	std::mt19937 random_engine;
+	float noise_table[noise_table_size];
+	std::chrono::steady_clock::time_point clock_origin;
+	int origin_frame = 0;
+	int last_frame = -1;
+
+	// When a capture is open, images come from it instead of the generator
+	ReplaySource replay;
+
+	template <typename T, typename B>
+	int SetBounded(T& target, T data, B min, B max)
+	{
+		std::lock_guard<std::mutex> lock(device_lock);
+		if (!connected)
+			return -2;
+		if (!(data >= min && data <= max))
+			return -3;
+		target = data;
+		return 0;
+	}
+
+	template <typename T>
+	int GetStored(const T& source, T* data)
+	{
+		std::lock_guard<std::mutex> lock(device_lock);
+		if (!connected)
+			return -2;
+		*data = source;
+		return 0;
+	}
+
+	int Command()
+	{
+		std::lock_guard<std::mutex> lock(device_lock);
+		return connected ? 0 : -2;
+	}
+
+	void ResetImageChannel()
+	{
+		process = ProcessState();
+		process.RefWidth = parameters.ManualReferenceWidthValue;
+		random_engine.seed(config.Seed);
+		std::normal_distribution<float> normal(0.0f, 1.0f);
+		for (int i = 0; i < noise_table_size; i++)
+			noise_table[i] = normal(random_engine);
+		clock_origin = std::chrono::steady_clock::now();
+		origin_frame = 0;
+		last_frame = -1;
+	}
+
+	// Waits until the next frame is due and returns its number. Frames the caller was too slow to read are skipped, as on the device
+	int NextFrameNumber(const ClamirSimConfig& settings, bool rebase)
+	{
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (rebase)
+		{
+			clock_origin = now;
+			origin_frame = last_frame + 1;
+		}
+		if (settings.FrameRate <= 0)
+			return ++last_frame;
+
+		double period = 1.0 / settings.FrameRate;
+		double elapsed = std::chrono::duration<double>(now - clock_origin).count();
+		int due = origin_frame + (int)(elapsed / period);
+		int frame = std::max(last_frame + 1, due);
+		std::chrono::steady_clock::time_point deadline = clock_origin + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>((frame - origin_frame) * period));
+		if (deadline > now)
+			std::this_thread::sleep_until(deadline);
+		last_frame = frame;
+		return frame;
+	}
+
+	bool InsideROI(const DeviceParameters& p, int x, int y)
+	{
+		RoiSettings roi = { p.EnableROI, p.ROIX1, p.ROIY1, p.ROIX2, p.ROIY2, p.RoundROI };
+		return RoiContains(roi, x, y);
+	}
+
+	void GenerateFrame(const DeviceParameters& p, const ClamirSimConfig& settings, int frame, ImageHeader* header, int16_t* image)
+	{
+		double rate = settings.FrameRate > 0 ? settings.FrameRate : 1000.0;
+		double dt = 1.0 / rate;
+		double t = frame * dt;
+
+		// Laser pattern: continuous mode keeps the laser on and counts tracks by time, the other modes alternate tracks and pauses
+		double trackDuration = std::max(0.1f, p.TrackDuration);
+		double cycle = p.Mode == 0 ? trackDuration : trackDuration + settings.TrackOffTime;
+		int track = (int)(t / cycle) + 1;
+		double timeInTrack = fmod(t, cycle);
+		bool laserOn = p.Mode == 0 || timeInTrack < trackDuration;
+		if (p.ShutterPosition)
+			laserOn = false;
+
+		// Melt pool geometry follows the applied power, widens while the track heats up and wobbles slowly
+		std::uniform_real_distribution<double> uniform(0.0, 1.0);
+		double power = process.Power > 0 ? process.Power : p.ManualPower;
+		double gain = (p.IntegrationTime / 200.0) * (p.BiasVoltage / 2.0);
+		double peak = laserOn ? (1500.0 + 3.0 * power) * gain : 0.0;
+		double heating = 1.0 + 0.1 * (1.0 - exp(-timeInTrack / 0.5));
+		double wobble = 1.0 + 0.05 * sin(2.0 * 3.14159265358979 * t / 3.0) + 0.02 * (uniform(random_engine) - 0.5);
+		double sigmaX = (3.0 + power / 500.0) * heating * wobble;
+		double sigmaY = 1.6 * sigmaX;
+		double centerX = 31.5 + 0.8 * sin(t * 1.7);
+		double centerY = 31.5 + 0.8 * cos(t * 1.3);
+		double background = 300.0 + 0.1 * (p.BlackLevel - 1000);
+
+		double profileX[CLAMIR_IMAGE_WIDTH], profileY[CLAMIR_IMAGE_HEIGHT];
+		for (int x = 0; x < CLAMIR_IMAGE_WIDTH; x++)
+			profileX[x] = exp(-0.5 * (x - centerX) * (x - centerX) / (sigmaX * sigmaX));
+		for (int y = 0; y < CLAMIR_IMAGE_HEIGHT; y++)
+			profileY[y] = peak * exp(-0.5 * (y - centerY) * (y - centerY) / (sigmaY * sigmaY));
+
+		int noiseOffset = (int)(random_engine() & (noise_table_size - 1));
+		for (int y = 0; y < CLAMIR_IMAGE_HEIGHT; y++)
+		{
+			for (int x = 0; x < CLAMIR_IMAGE_WIDTH; x++)
+			{
+				double value = background + profileY[y] * profileX[x] + settings.NoiseSigma * noise_table[(noiseOffset + y * CLAMIR_IMAGE_WIDTH + x) & (noise_table_size - 1)];
+				image[y * CLAMIR_IMAGE_WIDTH + x] = (int16_t)std::min(std::max(value, 0.0), (double)max_pixel_value);
+			}
+		}
+
+		if (laserOn && settings.SpatterRate > 0)
+		{
+			std::poisson_distribution<int> spatterCount(settings.SpatterRate);
+			int particles = spatterCount(random_engine);
+			for (int i = 0; i < particles; i++)
+			{
+				int x = (int)(uniform(random_engine) * CLAMIR_IMAGE_WIDTH);
+				int y = (int)(uniform(random_engine) * CLAMIR_IMAGE_HEIGHT);
+				int size = uniform(random_engine) < 0.7 ? 1 : 2;
+				double amplitude = 1500.0 + 2500.0 * uniform(random_engine);
+				for (int dy = 0; dy < size && y + dy < CLAMIR_IMAGE_HEIGHT; dy++)
+					for (int dx = 0; dx < size && x + dx < CLAMIR_IMAGE_WIDTH; dx++)
+					{
+						int16_t& pixel = image[(y + dy) * CLAMIR_IMAGE_WIDTH + x + dx];
+						pixel = (int16_t)std::min(pixel + amplitude, (double)max_pixel_value);
+					}
+			}
+		}
+
+		// Device measurements over the generated image
+		int area = 0, frameMax = 0;
+		for (int y = 0; y < CLAMIR_IMAGE_HEIGHT; y++)
+			for (int x = 0; x < CLAMIR_IMAGE_WIDTH; x++)
+			{
+				int value = image[y * CLAMIR_IMAGE_WIDTH + x];
+				frameMax = std::max(frameMax, value);
+				if (value > p.Threshold && InsideROI(p, x, y))
+					area++;
+			}
+		double above = p.Threshold - background;
+		double width = peak > above && above > 0 ? 2.0 * sigmaX * sqrt(2.0 * log(peak / above)) * p.PixelToMillimeterRatio : 0.0;
+
+		// Laser detection with the start/end area hysteresis
+		bool wasDetected = process.LaserDetected;
+		process.LaserDetected = wasDetected ? area >= p.ThresholdToEndTracks : area >= p.ThresholdToStartTracks;
+		if (process.LaserDetected && !wasDetected)
+			process.LaserOnSince = t;
+
+		process.WidthBuffer[process.WidthBufferNext] = width;
+		process.WidthBufferNext = (process.WidthBufferNext + 1) % std::max<int>(1, p.CircularBufferSize);
+		process.WidthBufferCount = std::min<int>(process.WidthBufferCount + 1, std::max<int>(1, p.CircularBufferSize));
+		double averageWidth = 0;
+		for (int i = 0; i < process.WidthBufferCount; i++)
+			averageWidth += process.WidthBuffer[i];
+		averageWidth /= process.WidthBufferCount;
+
+		int trackNum = p.Mode == 2 ? 0 : track;
+		char state;
+		double targetPower = p.ManualPower;
+		if (p.Mode == 2)
+			state = CLAMIR_STATE_MANUAL;
+		else if (!process.LaserDetected)
+			state = CLAMIR_STATE_IDLE;
+		else if (p.EnablePreheating && track == 1 && timeInTrack * 1000.0 < p.PreheatingTime)
+		{
+			state = CLAMIR_STATE_PREHEATING;
+			targetPower = p.PreheatingPower;
+		}
+		else if (track <= p.ReferenceTrackEnd)
+			state = CLAMIR_STATE_SET_POINT;
+		else
+			state = CLAMIR_STATE_CONTROL;
+
+		// Reference width from the set point tracks when automeasure is enabled
+		if (state == CLAMIR_STATE_SET_POINT && p.Automeasure && track >= p.ReferenceTrackStart)
+		{
+			process.RefWidthSum += width;
+			process.RefWidthCount++;
+			process.RefWidth = process.RefWidthSum / process.RefWidthCount;
+		}
+
+		// PID on the averaged width, gains in watts per millimeter, integral clamped to LimitIntegral, output clamped to both power ranges and slew limited in W/ms
+		if (state == CLAMIR_STATE_CONTROL && (t - process.LaserOnSince) * 1000.0 >= p.LaserONDelay)
+		{
+			double error = process.RefWidth - averageWidth;
+			process.Integral = std::min(std::max(process.Integral + p.KI * error * dt, -(double)p.LimitIntegral), (double)p.LimitIntegral);
+			double derivative = p.KD * (error - process.LastError) / (dt * 1000.0);
+			process.LastError = error;
+			targetPower = p.ManualPower + p.KP * error + process.Integral + derivative;
+			targetPower = std::min(std::max(targetPower, (double)std::max(p.PowerLimitMin, p.MinPower)), (double)std::min(p.PowerLimitMax, p.MaxPower));
+		}
+		else
+		{
+			process.Integral = 0;
+			process.LastError = 0;
+		}
+		double maxStep = p.LimitSlewRate * dt * 1000.0;
+		double current = process.Power > 0 ? process.Power : targetPower;
+		process.Power = current + std::min(std::max(targetPower - current, -maxStep), maxStep);
+
+		// Alarm on Out1 when the width stays outside the alarm band for AlarmTime milliseconds
+		int16_t io = 0;
+		if (p.EnableAlarm && process.LaserDetected && (width > p.AlarmMax || width < p.AlarmMin))
+		{
+			if (process.AlarmSince < 0)
+				process.AlarmSince = t;
+			if ((t - process.AlarmSince) * 1000.0 >= p.AlarmTime)
+				io |= 1 << 2;
+		}
+		else
+			process.AlarmSince = -1;
+		if (p.DigitalOut[0])
+			io |= 1 << 2;
+		if (p.DigitalOut[1])
+			io |= 1 << 3;
+		if (p.DigitalOut[2])
+			io |= 1 << 6;
+		if (p.DigitalOut[3])
+			io |= 1 << 7;
+
+		header->Power = (int)lround(process.Power);
+		header->MeltPoolArea = area;
+		header->TrackNum = trackNum;
+		header->FrameMax = frameMax;
+		header->FrameNum = frame;
+		header->Width = (float)width;
+		header->RefWidth = (float)process.RefWidth;
+		header->Temperature = (float)(35.0 + 5.0 * (1.0 - exp(-t / 600.0)) + 0.05 * (uniform(random_engine) - 0.5));
+		header->LaserStatus = process.LaserDetected ? 1 : 0;
+		header->StateMachine = state;
+		header->IODigitalPortStatus = io;
+	}
+
+	int ReadFrame(int* rawHeader, int16_t* aImage)
+	{
+		DeviceParameters p;
+		ClamirSimConfig settings;
+		bool rebase;
+		{
+			std::lock_guard<std::mutex> lock(device_lock);
+			if (!connected)
+				return -3;
+			p = parameters;
+			settings = config;
+			rebase = config_changed;
+			config_changed = false;
+		}
+
+		std::lock_guard<std::mutex> lock(image_lock);
+		if (replay.IsOpen())
+			return replay.Read(rawHeader, aImage, settings.FrameRate);
+
+		ImageHeader header;
+		int frame = NextFrameNumber(settings, rebase);
+		GenerateFrame(p, settings, frame, &header, aImage);
+		uint64_t timestamp = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - clock_origin).count();
+		EncodeRawHeader(header, timestamp, rawHeader);
+		return 0;
+	}
+}
+
+extern "C" CLAMIRDLL_API int ConnectCLAMIR(char *aIPaddress)
+{
+	if (!aIPaddress || !aIPaddress[0])
+		return -2;
+	std::lock_guard<std::mutex> lock(device_lock);
+	if (!link_up)
+		return -2;
+	if (!connected)
+	{
+		std::lock_guard<std::mutex> imageLock(image_lock);
+		ResetImageChannel();
+		connected = true;
+	}
+	return 0;
+}
+
+extern "C" CLAMIRDLL_API int DisconnectCLAMIR()
+{
+	std::lock_guard<std::mutex> lock(device_lock);
+	connected = false;
+	return 0;
+}
+
+extern "C" CLAMIRDLL_API int IsConnected()
+{
+	std::lock_guard<std::mutex> lock(device_lock);
+	return connected ? 1 : 0;
+}
+
+extern "C" CLAMIRDLL_API int GetImage(ImageHeader *aImageHeader, int16_t *aImage)
+{
+	int rawHeader[CLAMIR_RAW_HEADER_INTS];
+	int result = ReadFrame(rawHeader, aImage);
+	if (result == 0)
+		DecodeRawHeader(rawHeader, aImageHeader);
+	return result;
+}
+
+extern "C" CLAMIRDLL_API int GetImageRawHeader(int *rawHeader, int16_t *aImage)
+{
+	return ReadFrame(rawHeader, aImage);
+}
+
+extern "C" CLAMIRDLL_API int KISet(int16_t data) { return SetBounded(parameters.KI, data, 0, 30000); }
+extern "C" CLAMIRDLL_API int KIGet(int16_t *data) { return GetStored(parameters.KI, data); }
+extern "C" CLAMIRDLL_API int KPSet(int16_t data) { return SetBounded(parameters.KP, data, 0, 30000); }
+extern "C" CLAMIRDLL_API int KPGet(int16_t *data) { return GetStored(parameters.KP, data); }
+extern "C" CLAMIRDLL_API int KDSet(int16_t data) { return SetBounded(parameters.KD, data, 0, 30000); }
+extern "C" CLAMIRDLL_API int KDGet(int16_t *data) { return GetStored(parameters.KD, data); }
+extern "C" CLAMIRDLL_API int MaxPowerSet(int16_t data) { return SetBounded(parameters.MaxPower, data, 100, 30000); }
+extern "C" CLAMIRDLL_API int MaxPowerGet(int16_t *data) { return GetStored(parameters.MaxPower, data); }
+extern "C" CLAMIRDLL_API int MinPowerSet(int16_t data) { return SetBounded(parameters.MinPower, data, -30000, 9900); }
+extern "C" CLAMIRDLL_API int MinPowerGet(int16_t *data) { return GetStored(parameters.MinPower, data); }
+extern "C" CLAMIRDLL_API int ThresholdSet(int16_t data) { return SetBounded(parameters.Threshold, data, 0, 5000); }
+extern "C" CLAMIRDLL_API int ThresholdGet(int16_t *data) { return GetStored(parameters.Threshold, data); }
+extern "C" CLAMIRDLL_API int ThresholdToStartTracksSet(int16_t data) { return SetBounded(parameters.ThresholdToStartTracks, data, 0, 2000); }
+extern "C" CLAMIRDLL_API int ThresholdToStartTracksGet(int16_t *data) { return GetStored(parameters.ThresholdToStartTracks, data); }
+extern "C" CLAMIRDLL_API int ThresholdToEndTracksSet(int16_t data) { return SetBounded(parameters.ThresholdToEndTracks, data, 0, 1000); }
+extern "C" CLAMIRDLL_API int ThresholdToEndTracksGet(int16_t *data) { return GetStored(parameters.ThresholdToEndTracks, data); }
+extern "C" CLAMIRDLL_API int ManualPowerSet(int16_t data) { return SetBounded(parameters.ManualPower, data, 0, 30000); }
+extern "C" CLAMIRDLL_API int ManualPowerGet(int16_t *data) { return GetStored(parameters.ManualPower, data); }
+extern "C" CLAMIRDLL_API int AutoCalibrateSet() { return Command(); }
+extern "C" CLAMIRDLL_API int ModeSet(int16_t data) { return SetBounded(parameters.Mode, data, 0, 2); }
+extern "C" CLAMIRDLL_API int ModeGet(int16_t *data) { return GetStored(parameters.Mode, data); }
+extern "C" CLAMIRDLL_API int ReferenceTrackStartSet(int16_t data) { return SetBounded(parameters.ReferenceTrackStart, data, 0, 100); }
+extern "C" CLAMIRDLL_API int ReferenceTrackStartGet(int16_t *data) { return GetStored(parameters.ReferenceTrackStart, data); }
+extern "C" CLAMIRDLL_API int ReferenceTrackEndSet(int16_t data) { return SetBounded(parameters.ReferenceTrackEnd, data, 0, 100); }
+extern "C" CLAMIRDLL_API int ReferenceTrackEndGet(int16_t *data) { return GetStored(parameters.ReferenceTrackEnd, data); }
+extern "C" CLAMIRDLL_API int TrackDurationSet(float data) { return SetBounded(parameters.TrackDuration, data, 0.1f, 1000.0f); }
+extern "C" CLAMIRDLL_API int TrackDurationGet(float *data) { return GetStored(parameters.TrackDuration, data); }
+extern "C" CLAMIRDLL_API int ManualReferenceWidthValueSet(float data) { return SetBounded(parameters.ManualReferenceWidthValue, data, 0.0f, 65.0f); }
+extern "C" CLAMIRDLL_API int ManualReferenceWidthValueGet(float *data) { return GetStored(parameters.ManualReferenceWidthValue, data); }
+
+extern "C" CLAMIRDLL_API int UpdateSetPointSet()
+{
+	int result = Command();
+	if (result == 0)
+	{
+		float width = 0;
+		GetStored(parameters.ManualReferenceWidthValue, &width);
+		std::lock_guard<std::mutex> lock(image_lock);
+		process.RefWidth = width;
+		process.RefWidthSum = 0;
+		process.RefWidthCount = 0;
+	}
+	return result;
+}
+
+extern "C" CLAMIRDLL_API int RoundROISet(int16_t data) { return SetBounded(parameters.RoundROI, data, 0, 3); }
+extern "C" CLAMIRDLL_API int RoundROIGet(int16_t *data) { return GetStored(parameters.RoundROI, data); }
+extern "C" CLAMIRDLL_API int EnableROISet(int data) { return SetBounded(parameters.EnableROI, data, 0, 1); }
+extern "C" CLAMIRDLL_API int EnableROIGet(int *data) { return GetStored(parameters.EnableROI, data); }
+
+extern "C" CLAMIRDLL_API int ROICoordinatesSet(int16_t X1, int16_t Y1, int16_t X2, int16_t Y2)
+{
+	std::lock_guard<std::mutex> lock(device_lock);
+	if (!connected)
+		return -2;
+	if (X1 < 1 || X1 > 62 || Y1 < 1 || Y1 > 62 || X2 < 2 || X2 > 63 || Y2 < 2 || Y2 > 63)
+		return -3;
+	if (X1 >= X2 || Y1 >= Y2)
+		return -4;
+	parameters.ROIX1 = X1;
+	parameters.ROIY1 = Y1;
+	parameters.ROIX2 = X2;
+	parameters.ROIY2 = Y2;
+	return 0;
+}
+
+extern "C" CLAMIRDLL_API int ROICoordinatesGet(int16_t *X1, int16_t *Y1, int16_t *X2, int16_t *Y2)
+{
+	std::lock_guard<std::mutex> lock(device_lock);
+	if (!connected)
+		return -2;
+	*X1 = parameters.ROIX1;
+	*Y1 = parameters.ROIY1;
+	*X2 = parameters.ROIX2;
+	*Y2 = parameters.ROIY2;
+	return 0;
+}
+
+extern "C" CLAMIRDLL_API int PowerLimitMaxSet(int16_t data) { return SetBounded(parameters.PowerLimitMax, data, 1, 30000); }
+extern "C" CLAMIRDLL_API int PowerLimitMaxGet(int16_t *data) { return GetStored(parameters.PowerLimitMax, data); }
+extern "C" CLAMIRDLL_API int PowerLimitMinSet(int16_t data) { return SetBounded(parameters.PowerLimitMin, data, 0, 9999); }
+extern "C" CLAMIRDLL_API int PowerLimitMinGet(int16_t *data) { return GetStored(parameters.PowerLimitMin, data); }
+extern "C" CLAMIRDLL_API int PixelToMillimeterRatioSet(float data) { return SetBounded(parameters.PixelToMillimeterRatio, data, 0.01f, 10.0f); }
+extern "C" CLAMIRDLL_API int PixelToMillimeterRatioGet(float *data) { return GetStored(parameters.PixelToMillimeterRatio, data); }
+extern "C" CLAMIRDLL_API int EndOfProcessTimeSet(int16_t data) { return SetBounded(parameters.EndOfProcessTime, data, 500, 30000); }
+extern "C" CLAMIRDLL_API int EndOfProcessTimeGet(int16_t *data) { return GetStored(parameters.EndOfProcessTime, data); }
+extern "C" CLAMIRDLL_API int LimitIntegralSet(int16_t data) { return SetBounded(parameters.LimitIntegral, data, 0, 10000); }
+extern "C" CLAMIRDLL_API int LimitIntegralGet(int16_t *data) { return GetStored(parameters.LimitIntegral, data); }
+extern "C" CLAMIRDLL_API int LimitSlewRateSet(float data) { return SetBounded(parameters.LimitSlewRate, data, 0.01f, 300.0f); }
+extern "C" CLAMIRDLL_API int LimitSlewRateGet(float *data) { return GetStored(parameters.LimitSlewRate, data); }
+extern "C" CLAMIRDLL_API int CircularBufferSizeSet(int16_t data) { return SetBounded(parameters.CircularBufferSize, data, 1, 512); }
+extern "C" CLAMIRDLL_API int CircularBufferSizeGet(int16_t *data) { return GetStored(parameters.CircularBufferSize, data); }
+extern "C" CLAMIRDLL_API int EnableAlarmSet(int data) { return SetBounded(parameters.EnableAlarm, data, 0, 1); }
+extern "C" CLAMIRDLL_API int EnableAlarmGet(int *data) { return GetStored(parameters.EnableAlarm, data); }
+extern "C" CLAMIRDLL_API int AlarmMaxSet(float data) { return SetBounded(parameters.AlarmMax, data, 0.0f, 320.0f); }
+extern "C" CLAMIRDLL_API int AlarmMaxGet(float *data) { return GetStored(parameters.AlarmMax, data); }
+extern "C" CLAMIRDLL_API int AlarmMinSet(float data) { return SetBounded(parameters.AlarmMin, data, 0.0f, 320.0f); }
+extern "C" CLAMIRDLL_API int AlarmMinGet(float *data) { return GetStored(parameters.AlarmMin, data); }
+extern "C" CLAMIRDLL_API int AlarmTimeSet(int16_t data) { return SetBounded(parameters.AlarmTime, data, 0, 10000); }
+extern "C" CLAMIRDLL_API int AlarmTimeGet(int16_t *data) { return GetStored(parameters.AlarmTime, data); }
+
+extern "C" CLAMIRDLL_API int SerialNumberGet(char *data)
+{
+	int result = Command();
+	if (result == 0)
+		// Exactly the 7 characters of the device, without a terminator
+		memcpy(data, "SIM0001", CLAMIR_SERIAL_NUMBER_CHARACTERS);
+	return result;
+}
+
+extern "C" CLAMIRDLL_API int AutomeasureSet(int data) { return SetBounded(parameters.Automeasure, data, 0, 1); }
+extern "C" CLAMIRDLL_API int AutomeasureGet(int *data) { return GetStored(parameters.Automeasure, data); }
+
+extern "C" CLAMIRDLL_API int AutoShutterConfigurationSet(int flagEnable, int flagEnableInProcess, int flagTemperatureDrift, int flagTimer)
+{
+	std::lock_guard<std::mutex> lock(device_lock);
+	if (!connected)
+		return -2;
+	if (flagEnable < 0 || flagEnable > 1 || flagEnableInProcess < 0 || flagEnableInProcess > 1 || flagTemperatureDrift < 0 || flagTemperatureDrift > 1 || flagTimer < 0 || flagTimer > 1 || flagTemperatureDrift + flagTimer != 1)
+		return -3;
+	parameters.AutoShutterEnable = flagEnable;
+	parameters.AutoShutterEnableInProcess = flagEnableInProcess;
+	parameters.AutoShutterTemperatureDrift = flagTemperatureDrift;
+	parameters.AutoShutterTimer = flagTimer;
+	return 0;
+}
+
+extern "C" CLAMIRDLL_API int AutoShutterConfigurationGet(int *flagEnable, int *flagEnableInProcess, int *flagTemperatureDrift, int *flagTimer)
+{
+	std::lock_guard<std::mutex> lock(device_lock);
+	if (!connected)
+		return -2;
+	*flagEnable = parameters.AutoShutterEnable;
+	*flagEnableInProcess = parameters.AutoShutterEnableInProcess;
+	*flagTemperatureDrift = parameters.AutoShutterTemperatureDrift;
+	*flagTimer = parameters.AutoShutterTimer;
+	return 0;
+}
+
+extern "C" CLAMIRDLL_API int AutoshutterDriftTemperatureSet(float data) { return SetBounded(parameters.AutoshutterDriftTemperature, data, 0.1f, 50.0f); }
+extern "C" CLAMIRDLL_API int AutoshutterDriftTemperatureGet(float *data) { return GetStored(parameters.AutoshutterDriftTemperature, data); }
+extern "C" CLAMIRDLL_API int AutoshutterTimerSet(float data) { return SetBounded(parameters.AutoshutterTimer, data, 10.0f, 320000.0f); }
+extern "C" CLAMIRDLL_API int AutoshutterTimerGet(float *data) { return GetStored(parameters.AutoshutterTimer, data); }
+extern "C" CLAMIRDLL_API int LaserExternalSet(int data) { return SetBounded(parameters.LaserExternal, data, 0, 1); }
+extern "C" CLAMIRDLL_API int LaserExternalGet(int *data) { return GetStored(parameters.LaserExternal, data); }
+extern "C" CLAMIRDLL_API int LaserONDelaySet(int16_t data) { return SetBounded(parameters.LaserONDelay, data, 0, 1000); }
+extern "C" CLAMIRDLL_API int LaserONDelayGet(int16_t *data) { return GetStored(parameters.LaserONDelay, data); }
+extern "C" CLAMIRDLL_API int EnablePreheatingSet(int data) { return SetBounded(parameters.EnablePreheating, data, 0, 1); }
+extern "C" CLAMIRDLL_API int EnablePreheatingGet(int *data) { return GetStored(parameters.EnablePreheating, data); }
+extern "C" CLAMIRDLL_API int PreheatingTimeSet(int16_t data) { return SetBounded(parameters.PreheatingTime, data, 0, 30000); }
+extern "C" CLAMIRDLL_API int PreheatingTimeGet(int16_t *data) { return GetStored(parameters.PreheatingTime, data); }
+extern "C" CLAMIRDLL_API int PreheatingPowerSet(int16_t data) { return SetBounded(parameters.PreheatingPower, data, 0, 10000); }
+extern "C" CLAMIRDLL_API int PreheatingPowerGet(int16_t *data) { return GetStored(parameters.PreheatingPower, data); }
+
+// The simulator has no digital inputs wired, they always read 0
+extern "C" CLAMIRDLL_API int DigitalOut1Set(int data) { return SetBounded(parameters.DigitalOut[0], data, 0, 1); }
+extern "C" CLAMIRDLL_API int DigitalIn1Get(int *data) { int none = 0; return GetStored(none, data); }
+extern "C" CLAMIRDLL_API int DigitalOut2Set(int data) { return SetBounded(parameters.DigitalOut[1], data, 0, 1); }
+extern "C" CLAMIRDLL_API int DigitalIn2Get(int *data) { int none = 0; return GetStored(none, data); }
+extern "C" CLAMIRDLL_API int DigitalOut3Set(int data) { return SetBounded(parameters.DigitalOut[2], data, 0, 1); }
+extern "C" CLAMIRDLL_API int DigitalIn3Get(int *data) { int none = 0; return GetStored(none, data); }
+extern "C" CLAMIRDLL_API int DigitalOut4Set(int data) { return SetBounded(parameters.DigitalOut[3], data, 0, 1); }
+extern "C" CLAMIRDLL_API int DigitalIn4Get(int *data) { int none = 0; return GetStored(none, data); }
+
+extern "C" CLAMIRDLL_API int IntegrationTimeSet(int16_t data) { return SetBounded(parameters.IntegrationTime, data, 50, 800); }
+extern "C" CLAMIRDLL_API int IntegrationTimeGet(int16_t *data) { return GetStored(parameters.IntegrationTime, data); }
+extern "C" CLAMIRDLL_API int BiasVoltageSet(float data) { return SetBounded(parameters.BiasVoltage, data, 1.0f, 3.0f); }
+extern "C" CLAMIRDLL_API int BiasVoltageGet(float *data) { return GetStored(parameters.BiasVoltage, data); }
+extern "C" CLAMIRDLL_API int ShutterPositionSet(int data) { return SetBounded(parameters.ShutterPosition, data, 0, 1); }
+extern "C" CLAMIRDLL_API int SaveEmbeddedConfigurationSet() { return Command(); }
+extern "C" CLAMIRDLL_API int BlackLevelSet(int16_t data) { return SetBounded(parameters.BlackLevel, data, 0, 10000); }
+extern "C" CLAMIRDLL_API int BlackLevelGet(int16_t *data) { return GetStored(parameters.BlackLevel, data); }
+
+extern "C" CLAMIRDLL_API int EmbeddedSWVersion(int16_t *data)
+{
+	int16_t version = 100;
+	return GetStored(version, data);
+}
+
+extern "C" CLAMIRDLL_API int ClamirSimGetConfig(ClamirSimConfig *config_out)
+{
+	std::lock_guard<std::mutex> lock(device_lock);
+	*config_out = config;
+	return 0;
+}
+
+extern "C" CLAMIRDLL_API int ClamirSimSetConfig(const ClamirSimConfig *config_in)
+{
+	if (config_in->FrameRate < 0 || config_in->TrackOffTime < 0 || config_in->SpatterRate < 0 || config_in->NoiseSigma < 0)
+		return -3;
+	std::lock_guard<std::mutex> lock(device_lock);
+	config = *config_in;
+	config_changed = true;
+	return 0;
+}
+
+extern "C" CLAMIRDLL_API int ClamirSimOpenReplay(const char *path, int realtime, int loop)
+{
+	std::lock_guard<std::mutex> lock(image_lock);
+	return replay.Open(path, realtime != 0, loop != 0);
+}
+
+extern "C" CLAMIRDLL_API int ClamirSimCloseReplay()
+{
+	std::lock_guard<std::mutex> lock(image_lock);
+	replay.Close();
+	return 0;
+}
+
+extern "C" CLAMIRDLL_API int ClamirSimReplayPosition(long long *position, long long *count)
+{
+	std::lock_guard<std::mutex> lock(image_lock);
+	if (!replay.IsOpen())
+		return -2;
+	*position = replay.Position();
+	*count = replay.Count();
+	return 0;
+}
+
+extern "C" CLAMIRDLL_API int ClamirSimSetLink(int up)
+{
+	std::lock_guard<std::mutex> lock(device_lock);
+	link_up = up != 0;
+	if (!link_up)
+		connected = false;
+	return 0;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+/** \file ClamirSim.h
+*	Simulated CLAMIR backend. The ClamirSim library exports every function of CLAMIR_dll.h, so linking it instead of the vendor DLL lets ClamirCpp run without a CLAMIR system and on platforms without winsock.
+*	Images are synthetic melt pools generated at a configurable frame rate. Parameters are stored with the defaults and bounds documented in CLAMIR_dll.h and return the same codes as the device.
+*	Instead of synthetic images the simulator can also replay a recorded NIT .dat capture through GetImage and GetImageRawHeader, to benchmark the pipeline on production data.
+*	The functions below are specific to the simulator and control where frames come from.
+*/
+
+#include "CLAMIR_dll.h"
+
+/**
+* @struct ClamirSimConfig
+* @brief Frame generation settings of the simulator
+* @param FrameRate Frames per second delivered by GetImage. 0 delivers frames as fast as they are requested
+* @param TrackOffTime Seconds of laser off between two tracks. Tracks last TrackDurationSet seconds
+* @param SpatterRate Mean number of spatter particles per frame
+* @param NoiseSigma Standard deviation of the background noise in digital counts
+* @param Seed Seed of the random generator, so runs can be reproduced. Applied on the next ConnectCLAMIR
+*/
+struct ClamirSimConfig
+{
+	float FrameRate, TrackOffTime, SpatterRate, NoiseSigma;
+	unsigned int Seed;
+};
+
+/**
+@brief Reads the current frame generation settings
+@param config Pointer where the function will store the settings
+@returns 0 always
+*/
+extern "C" CLAMIRDLL_API int ClamirSimGetConfig(ClamirSimConfig *config);
+
+/**
+@brief Replaces the frame generation settings. Takes effect on the next frame
+@param config Pointer to the new settings
+@returns 0 on success
+@returns -3 on an out of bounds value
+*/
+extern "C" CLAMIRDLL_API int ClamirSimSetConfig(const ClamirSimConfig *config);
+
+/**
+@brief Serves GetImage and GetImageRawHeader from a recorded NIT .dat capture instead of the generator
+
+*A capture is a sequence of 60 byte raw headers each followed by 4096 int16_t pixels. Raw headers are decoded for GetImage with the layout of RawHeader.h.
+*Parameters set and read while replaying are still stored by the simulator, but do not affect the replayed images.
+
+@param path Path of the .dat file
+@param realtime 1 to deliver frames at their recorded cadence, 0 to deliver them as fast as they are requested. Captures without timestamps use the FrameRate of ClamirSimConfig
+@param loop 1 to restart at the first frame at the end of the capture, 0 to return -3 (closed connection) from GetImage once every frame was served
+@returns 0 on success
+@returns -1 if the file cannot be opened
+@returns -2 if the file holds no complete frame
+*/
+extern "C" CLAMIRDLL_API int ClamirSimOpenReplay(const char *path, int realtime, int loop);
+
+/**
+@brief Closes the replayed capture and goes back to synthetic images
+@returns 0 always
+*/
+extern "C" CLAMIRDLL_API int ClamirSimCloseReplay();
+
+/**
+@brief Reads the replay progress
+@param position Pointer where the function will store the number of frames served since the start of the capture
+@param count Pointer where the function will store the number of frames of the capture
+@returns 0 on success
+@returns -2 if no capture is open
+*/
+extern "C" CLAMIRDLL_API int ClamirSimReplayPosition(long long *position, long long *count);
+
+/**
+@brief Emulates a network failure, to exercise reconnection
+
+*Taking the link down drops the connection: IsConnected returns 0, GetImage returns -3 and the commands -2. ConnectCLAMIR fails with -2 until the link is up again.
+
+@param up 0 to take the link down, 1 to restore it
+@returns 0 always
+*/
+extern "C" CLAMIRDLL_API int ClamirSimSetLink(int up);
@@ -0,0 +1,131 @@
+#include <string.h>
+#include <thread>
+#include "Replay.h"
+#include "RawHeader.h"
+
+#ifdef _WIN32
+#define replay_fseek _fseeki64
+#define replay_ftell _ftelli64
+#else
+#define replay_fseek fseeko
+#define replay_ftell ftello
+#endif
+
+namespace
+{
+	const size_t record_bytes = CLAMIR_RAW_HEADER_BYTES + CLAMIR_IMAGE_PIXELS * sizeof(int16_t);
+
+	// Records read from disk per fread, so fast replay is not bound by per-frame I/O calls
+	const size_t records_per_read = 256;
+}
+
+ReplaySource::ReplaySource()
+	: file(0), realtime(false), loop(false), dataOffset(0), count(0), position(0), bufferUsed(0), bufferRead(0),
+	haveOrigin(false), timestampOrigin(0), frameOrigin(0)
+{
+}
+
+ReplaySource::~ReplaySource()
+{
+	Close();
+}
+
+int ReplaySource::Open(const char* path, bool aRealtime, bool aLoop)
+{
+	Close();
+	file = fopen(path, "rb");
+	if (!file)
+		return -1;
+
+	replay_fseek(file, 0, SEEK_END);
+	long long size = replay_ftell(file);
+	count = size / (long long)record_bytes;
+	if (count == 0)
+	{
+		Close();
+		return -2;
+	}
+	dataOffset = size - count * (long long)record_bytes;
+	replay_fseek(file, dataOffset, SEEK_SET);
+
+	realtime = aRealtime;
+	loop = aLoop;
+	position = 0;
+	buffer.resize(record_bytes * records_per_read);
+	bufferUsed = bufferRead = 0;
+	haveOrigin = false;
+	return 0;
+}
+
+void ReplaySource::Close()
+{
+	if (file)
+	{
+		fclose(file);
+		file = 0;
+	}
+	count = position = 0;
+}
+
+int ReplaySource::Fill()
+{
+	if (position >= count)
+	{
+		if (!loop)
+			return -3;
+		replay_fseek(file, dataOffset, SEEK_SET);
+		position = 0;
+		haveOrigin = false;
+	}
+	size_t records = fread(buffer.data(), record_bytes, records_per_read, file);
+	if (records == 0)
+		return -2;
+	bufferUsed = records * record_bytes;
+	bufferRead = 0;
+	return 0;
+}
+
+void ReplaySource::WaitForDueTime(const int* rawHeader, double fallbackFrameRate)
+{
+	uint64_t timestamp = RawHeaderTimestamp(rawHeader);
+	int frameNum = rawHeader[RAW_FRAME_NUM];
+	if (!haveOrigin)
+	{
+		haveOrigin = true;
+		clockOrigin = std::chrono::steady_clock::now();
+		timestampOrigin = timestamp;
+		frameOrigin = frameNum;
+		return;
+	}
+
+	double offset;
+	if (timestamp > timestampOrigin)
+		offset = (timestamp - timestampOrigin) * 1e-6;
+	else if (fallbackFrameRate > 0)
+		offset = (frameNum - frameOrigin) / fallbackFrameRate;
+	else
+		return;
+	std::this_thread::sleep_until(clockOrigin + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(offset)));
+}
+
+int ReplaySource::Read(int* rawHeader, int16_t* aImage, double fallbackFrameRate)
+{
+	if (!file)
+		return -2;
+	if (bufferRead >= bufferUsed)
+	{
+		int result = Fill();
+		if (result != 0)
+			return result;
+	}
+
+	const char* record = buffer.data() + bufferRead;
+	memcpy(rawHeader, record, CLAMIR_RAW_HEADER_BYTES);
+	memcpy(aImage, record + CLAMIR_RAW_HEADER_BYTES, CLAMIR_IMAGE_PIXELS * sizeof(int16_t));
+	bufferRead += record_bytes;
+	position++;
+
+	if (realtime)
+		WaitForDueTime(rawHeader, fallbackFrameRate);
+	return 0;
+}
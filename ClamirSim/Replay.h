@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+#include "ClamirFrame.h"
+
+/**
+@class ReplaySource
+@brief Reads frames back from a NIT .dat capture for the simulator
+
+*A capture is a sequence of records, each one a 60 byte raw header followed by 4096 int16_t pixels. Bytes that do not fill a whole record are treated as a file header and skipped.
+*In real time mode frames are released at the cadence given by the raw header timestamps, or by the frame numbers and the fallback frame rate when the capture has no timestamps.
+*/
+class ReplaySource
+{
+public:
+	ReplaySource();
+	~ReplaySource();
+
+	/**
+	@returns 0 on success, -1 if the file cannot be opened, -2 if it holds no complete record
+	*/
+	int Open(const char* path, bool realtime, bool loop);
+	void Close();
+	bool IsOpen() const { return file != 0; }
+
+	/**
+	@brief Reads the next record, waiting for its due time in real time mode
+	@returns 0 on success, -3 at the end of a capture that does not loop, -2 on a read error
+	*/
+	int Read(int* rawHeader, int16_t* aImage, double fallbackFrameRate);
+
+	long long Position() const { return position; }
+	long long Count() const { return count; }
+
+private:
+	int Fill();
+	void WaitForDueTime(const int* rawHeader, double fallbackFrameRate);
+
+	FILE* file;
+	bool realtime, loop;
+	long long dataOffset, count, position;
+
+	std::vector<char> buffer;
+	size_t bufferUsed, bufferRead;
+
+	bool haveOrigin;
+	std::chrono::steady_clock::time_point clockOrigin;
+	uint64_t timestampOrigin;
+	int frameOrigin;
+};
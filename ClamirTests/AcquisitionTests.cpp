@@ -0,0 +1,82 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "TestHarness.h"
+#include "ClamirFunctions.h"
+#include "ClamirSim.h"
+
+CLAMIR_TEST(AcquisitionSurvivesStartPopStopCycles)
+{
+	CHECK(ConnectSimulator(0.0f) == 0);
+	std::atomic<bool> done(false);
+	std::atomic<long> popped(0);
+	// Pops with both overloads while the acquisition is started and stopped, and keeps leases across the stops
+	std::thread consumer([&]()
+	{
+		std::vector<FrameLease> held;
+		static int16_t aImage[CLAMIR_IMAGE_PIXELS];
+		while (!done.load())
+		{
+			FrameLease lease;
+			if (ClamirFunctions::PopFrame(&lease) == 0)
+			{
+				popped++;
+				if (!lease.IsValid() || lease.Header() == 0)
+					CheckFailed(__FILE__, __LINE__, "lease.IsValid()");
+				held.push_back(lease);
+				if (held.size() > 8)
+					held.erase(held.begin());
+			}
+			ImageHeader header;
+			if (ClamirFunctions::PopFrame(&header, aImage) == 0)
+				popped++;
+		}
+	});
+	int startFailures = 0;
+	for (int cycle = 0; cycle < 200; cycle++)
+	{
+		if (ClamirFunctions::StartAcquisition(8) != 0)
+			startFailures++;
+		std::this_thread::sleep_for(std::chrono::microseconds(300));
+		ClamirFunctions::StopAcquisition();
+	}
+	done.store(true);
+	consumer.join();
+	CHECK(startFailures == 0);
+	CHECK(popped.load() > 0);
+	ClamirFunctions::DisconnectDevice();
+}
+
+CLAMIR_TEST(AcquisitionReportsSelfStopOnClosedConnection)
+{
+	CHECK(ConnectSimulator(0.0f) == 0);
+	CHECK(ClamirFunctions::StartAcquisition(64) == 0);
+	std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	ClamirSimSetLink(0);
+	AcquisitionCounters counters;
+	for (int wait = 0; wait < 1000; wait++)
+	{
+		ClamirFunctions::GetAcquisitionCounters(&counters);
+		if (!counters.Running)
+			break;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	CHECK(counters.Running == 0);
+	CHECK(counters.LastError == -3);
+
+	// The queued frames can still be popped, then PopFrame reports the stop
+	FrameLease lease;
+	int result;
+	while ((result = ClamirFunctions::PopFrame(&lease)) == 0)
+		lease.Reset();
+	CHECK(result == -2);
+
+	ClamirSimSetLink(1);
+	CHECK(ClamirFunctions::ConnectDevice() == 0);
+	CHECK(ClamirFunctions::StartAcquisition(64) == 0);
+	ClamirFunctions::GetAcquisitionCounters(&counters);
+	CHECK(counters.Running == 1);
+	CHECK(ClamirFunctions::StopAcquisition() == 0);
+	ClamirFunctions::DisconnectDevice();
+}
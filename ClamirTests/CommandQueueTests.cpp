@@ -0,0 +1,42 @@
+#include <future>
+#include "TestHarness.h"
+#include "ClamirFunctions.h"
+#include "CommandQueue.h"
+#include "DeviceCallStats.h"
+
+CLAMIR_TEST(CommandQueueCoalescesPendingWrites)
+{
+	CHECK(ConnectSimulator(0.0f) == 0);
+	DeviceCallSnapshot before, after;
+	DeviceCallStats::Snapshot(CALL_ThresholdSet, &before);
+	{
+		CommandQueue queue;
+		// Holds the executor so the writes below all wait behind it
+		std::promise<void> latch;
+		std::shared_future<void> opened = latch.get_future().share();
+		std::shared_future<int> blocker = queue.Execute([opened]() { opened.wait(); return 0; });
+
+		std::shared_future<int> first = queue.ThresholdSet(1000);
+		std::shared_future<int> second = queue.ThresholdSet(1100);
+		std::shared_future<int> third = queue.ThresholdSet(1300);
+		CHECK(queue.Counters().Coalesced == 2);
+		latch.set_value();
+		queue.Wait();
+
+		CHECK(blocker.get() == 0);
+		CHECK(first.get() == 0 && second.get() == 0 && third.get() == 0);
+		// One write shared by the three callers
+		CHECK(&first.get() == &second.get() && &second.get() == &third.get());
+		CommandQueueCounters counters = queue.Counters();
+		CHECK(counters.Submitted == 4 && counters.Coalesced == 2 && counters.Executed == 2 && counters.Pending == 0);
+	}
+	DeviceCallStats::Snapshot(CALL_ThresholdSet, &after);
+	CHECK(after.Calls - before.Calls == 1);
+	int16_t threshold = 0;
+	{
+		ClamirSession::CommandLock command;
+		CHECK(ThresholdGet(&threshold) == 0);
+	}
+	CHECK(threshold == 1300);
+	ClamirFunctions::DisconnectDevice();
+}
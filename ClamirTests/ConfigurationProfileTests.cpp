@@ -0,0 +1,52 @@
+#include "TestHarness.h"
+#include "ClamirFunctions.h"
+#include "ConfigurationProfile.h"
+
+namespace
+{
+	ConfigurationProfile PowerProfile(int minPower, int maxPower)
+	{
+		ConfigurationProfile profile;
+		profile.Set(PARAMETER_MinPower, minPower);
+		profile.Set(PARAMETER_MaxPower, maxPower);
+		return profile;
+	}
+
+	// Plans the profile against the cache, checks the order of the writes, applies it and checks what the device holds
+	void CheckApply(const ConfigurationProfile& profile, int first, int second, int minPower, int maxPower)
+	{
+		ParameterSnapshot current;
+		CHECK(ClamirFunctions::GetParameters(&current) == 0);
+		int writes[PARAMETER_COUNT];
+		CHECK(profile.Plan(current, writes) == 2);
+		CHECK(writes[0] == first && writes[1] == second);
+		// Sent the other way round, the first write would break MinPower < MaxPower against the cached value
+		CHECK(ClamirFunctions::ValidateParameter(second, second == PARAMETER_MinPower ? minPower : maxPower) == -4);
+
+		ProfileApplyResult result;
+		CHECK(ClamirFunctions::ApplyProfile(profile, &result) == 0);
+		CHECK(result.Planned == 2 && result.Written == 2 && result.FailedParameter == -1);
+		int16_t deviceMin = 0, deviceMax = 0;
+		{
+			ClamirSession::CommandLock command;
+			CHECK(MinPowerGet(&deviceMin) == 0 && MaxPowerGet(&deviceMax) == 0);
+		}
+		CHECK(deviceMin == minPower && deviceMax == maxPower);
+	}
+}
+
+CLAMIR_TEST(ApplyProfileOrdersPairedLimits)
+{
+	CHECK(ConnectSimulator(0.0f) == 0);
+	ProfileApplyResult result;
+	CHECK(ClamirFunctions::ApplyProfile(PowerProfile(500, 1500), &result) == 0);
+
+	// Both limits move above the current MaxPower, so MaxPower goes first
+	CheckApply(PowerProfile(2000, 3000), PARAMETER_MaxPower, PARAMETER_MinPower, 2000, 3000);
+	// Both move below the current MinPower, so MinPower goes first
+	CheckApply(PowerProfile(100, 400), PARAMETER_MinPower, PARAMETER_MaxPower, 100, 400);
+
+	CHECK(ClamirFunctions::ApplyProfile(PowerProfile(100, 400), &result) == 0);
+	CHECK(result.Planned == 0 && result.Written == 0 && result.FailedParameter == -1);
+	ClamirFunctions::DisconnectDevice();
+}
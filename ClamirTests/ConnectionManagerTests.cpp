@@ -0,0 +1,125 @@
+#include <limits.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "TestHarness.h"
+#include "ClamirFunctions.h"
+#include "ClamirSim.h"
+#include "ConnectionManager.h"
+
+namespace
+{
+	// Pops frames for a while and returns how many arrived
+	int PopFor(int milliseconds)
+	{
+		static int16_t aImage[CLAMIR_IMAGE_PIXELS];
+		ImageHeader header;
+		int frames = 0;
+		std::chrono::steady_clock::time_point until = std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds);
+		while (std::chrono::steady_clock::now() < until)
+			if (ClamirFunctions::PopFrame(&header, aImage) == 0)
+				frames++;
+		return frames;
+	}
+
+	std::atomic<int> connection_lost_calls(0);
+
+	void CountConnectionLost(void*)
+	{
+		connection_lost_calls++;
+	}
+}
+
+CLAMIR_TEST(ConnectionLostIsReportedOncePerConnection)
+{
+	CHECK(ConnectSimulator(2000.0f) == 0);
+	connection_lost_calls = 0;
+	ClamirFunctions::SetConnectionLostCallback(CountConnectionLost, 0);
+	CHECK(ClamirFunctions::StartAcquisition(64) == 0);
+	// The acquisition thread keeps reading through each outage; only its first failed read is reported
+	for (int outage = 0; outage < 3; outage++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		ClamirSimSetLink(0);
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		ClamirSimSetLink(1);
+		CHECK(ClamirSession::Default().Connect() == 0);
+	}
+	CHECK(PopFor(50) > 0);
+	CHECK(ClamirFunctions::StopAcquisition() == 0);
+	ClamirFunctions::SetConnectionLostCallback(nullptr, nullptr);
+	CHECK(connection_lost_calls.load() == 3);
+	ClamirFunctions::DisconnectDevice();
+}
+
+CLAMIR_TEST(ConnectionManagerRejectsInvalidSettings)
+{
+	ConnectionManager manager;
+	ConnectionSettings settings = ConnectionManager::DefaultSettings();
+	settings.InitialBackoff = 0;
+	CHECK(manager.Start(&settings) == -3);
+	settings.InitialBackoff = 10;
+	settings.MaxBackoff = 5;
+	CHECK(manager.Start(&settings) == -3);
+	settings.InitialBackoff = 1;
+	settings.MaxBackoff = INT_MAX;
+	CHECK(manager.Start(&settings) == 0);
+	CHECK(manager.WaitConnected(5000) == 0);
+	CHECK(manager.Stop() == 0);
+}
+
+CLAMIR_TEST(ConnectionManagerReconnectsAfterLinkDrop)
+{
+	ClamirSimConfig config;
+	ClamirSimGetConfig(&config);
+	config.FrameRate = 2000.0f;
+	ClamirSimSetConfig(&config);
+	ClamirSimSetLink(0);
+
+	ConnectionManager manager;
+	ConnectionSettings settings = ConnectionManager::DefaultSettings();
+	CHECK(manager.Start(&settings) == 0);
+	CHECK(manager.Start(&settings) == -1);
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	CHECK(manager.WaitConnected(0) == -1);
+	CHECK(manager.State() == CONNECTION_CONNECTING);
+	ClamirSimSetLink(1);
+	CHECK(manager.WaitConnected(5000) == 0);
+	CHECK(manager.Counters().Attempts > 1);
+
+	CHECK(ClamirFunctions::StartAcquisition(256) == 0);
+	CHECK(PopFor(50) > 0);
+
+	// GetImage sees the closed connection and the acquisition resumes once the manager reconnects
+	ClamirSimSetLink(0);
+	std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	ClamirSimSetLink(1);
+	ConnectionCounters counters = manager.Counters();
+	for (int wait = 0; wait < 5000 && (counters.LinkLosses == 0 || counters.State != CONNECTION_CONNECTED); wait++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		counters = manager.Counters();
+	}
+	CHECK(counters.LinkLosses >= 1);
+	CHECK(counters.State == CONNECTION_CONNECTED);
+	CHECK(counters.Connects >= 2);
+	CHECK(PopFor(100) > 0);
+
+	CHECK(ClamirFunctions::StopAcquisition() == 0);
+	CHECK(manager.Stop() == 0);
+	CHECK(manager.State() == CONNECTION_STOPPED);
+}
+
+CLAMIR_TEST(ConnectionManagerGivesUpAfterMaxAttempts)
+{
+	ClamirSimSetLink(0);
+	ConnectionManager manager;
+	ConnectionSettings settings = ConnectionManager::DefaultSettings();
+	settings.MaxAttempts = 3;
+	CHECK(manager.Start(&settings) == 0);
+	CHECK(manager.WaitConnected(5000) == -2);
+	CHECK(manager.State() == CONNECTION_FAILED);
+	CHECK(manager.Counters().Attempts == 3);
+	manager.Stop();
+	ClamirSimSetLink(1);
+}
@@ -0,0 +1,58 @@
+#include <stdlib.h>
+#include <string.h>
+#include "TestHarness.h"
+#include "ClamirFunctions.h"
+#include "FrameCodec.h"
+
+namespace
+{
+	// Encodes and decodes a frame; a truncated encoding must be refused
+	bool RoundTrips(const int16_t* aImage)
+	{
+		static uint8_t encoded[CLAMIR_CODEC_MAX_BYTES];
+		static int16_t decoded[CLAMIR_IMAGE_PIXELS];
+		size_t length = FrameCodec::Encode(aImage, encoded);
+		if (length == 0 || length > CLAMIR_CODEC_MAX_BYTES)
+			return false;
+		if (!FrameCodec::Decode(encoded, length, decoded) || FrameCodec::Decode(encoded, length - 1, decoded))
+			return false;
+		return memcmp(decoded, aImage, sizeof(decoded)) == 0;
+	}
+}
+
+CLAMIR_TEST(FrameCodecRoundTripsSimulatedFrames)
+{
+	CHECK(ConnectSimulator(0.0f) == 0);
+	static int16_t aImage[CLAMIR_IMAGE_PIXELS];
+	int rawHeader[CLAMIR_RAW_HEADER_INTS];
+	int failures = 0;
+	for (int i = 0; i < 500; i++)
+	{
+		CHECK(GetImageRawHeader(rawHeader, aImage) == 0);
+		if (!RoundTrips(aImage))
+			failures++;
+	}
+	CHECK(failures == 0);
+	ClamirFunctions::DisconnectDevice();
+}
+
+CLAMIR_TEST(FrameCodecRoundTripsExtremeFrames)
+{
+	static int16_t aImage[CLAMIR_IMAGE_PIXELS];
+	memset(aImage, 0, sizeof(aImage));
+	CHECK(RoundTrips(aImage));
+	for (int i = 0; i < CLAMIR_IMAGE_PIXELS; i++)
+		aImage[i] = (i & 1) ? INT16_MAX : INT16_MIN;
+	CHECK(RoundTrips(aImage));
+
+	srand(1);
+	int failures = 0;
+	for (int bits = 1; bits <= 16; bits++)
+	{
+		for (int i = 0; i < CLAMIR_IMAGE_PIXELS; i++)
+			aImage[i] = (int16_t)(((unsigned)rand() ^ ((unsigned)rand() << 8)) & ((1u << bits) - 1));
+		if (!RoundTrips(aImage))
+			failures++;
+	}
+	CHECK(failures == 0);
+}
@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "TestHarness.h"
+#include "FrameRecorder.h"
+
+namespace
+{
+	const int frame_count = 2000;
+
+	int16_t Pixel(int frame, int i)
+	{
+		return (int16_t)((i * 7 + frame) % 1000);
+	}
+
+	void WriteCapture(const std::string& path, bool compress)
+	{
+		FrameRecorder recorder;
+		// A small growth step so the capture is grown and remapped many times
+		CHECK(recorder.Open(path.c_str(), 1 << 20) == 0);
+		recorder.SetCompression(compress);
+		static int16_t aImage[CLAMIR_IMAGE_PIXELS];
+		for (int frame = 0; frame < frame_count; frame++)
+		{
+			ImageHeader header;
+			memset(&header, 0, sizeof(header));
+			header.FrameNum = frame;
+			header.Power = frame % 300;
+			for (int i = 0; i < CLAMIR_IMAGE_PIXELS; i++)
+				aImage[i] = Pixel(frame, i);
+			CHECK(recorder.Append(header, aImage) == 0);
+		}
+		CHECK(recorder.FrameCount() == frame_count);
+		CHECK(recorder.Close() == 0);
+	}
+
+	// Counts the frames of a capture that do not read back as written
+	int BadFrames(const FrameRecording& recording)
+	{
+		static int16_t aImage[CLAMIR_IMAGE_PIXELS];
+		int bad = 0;
+		for (int frame = 0; frame < frame_count; frame++)
+		{
+			ImageHeader header;
+			if (recording.ReadFrame(frame, &header, aImage) != 0 || header.FrameNum != frame || header.Power != frame % 300)
+			{
+				bad++;
+				continue;
+			}
+			for (int i = 0; i < CLAMIR_IMAGE_PIXELS; i++)
+				if (aImage[i] != Pixel(frame, i))
+				{
+					bad++;
+					break;
+				}
+		}
+		return bad;
+	}
+
+	void CheckRoundTrip(bool compress)
+	{
+		std::string path = TestPath(compress ? "compressed.clmr" : "raw.clmr");
+		WriteCapture(path, compress);
+		FrameRecording recording;
+		CHECK(recording.Open(path.c_str()) == 0);
+		CHECK(recording.FrameCount() == frame_count);
+		CHECK(BadFrames(recording) == 0);
+		ImageHeader header;
+		static int16_t aImage[CLAMIR_IMAGE_PIXELS];
+		CHECK(recording.ReadFrame(frame_count, &header, aImage) == -1);
+		recording.Close();
+		RemoveTestFiles(path);
+	}
+}
+
+CLAMIR_TEST(FrameRecorderRoundTripsRawFrames)
+{
+	CheckRoundTrip(false);
+}
+
+CLAMIR_TEST(FrameRecorderRoundTripsCompressedFrames)
+{
+	CheckRoundTrip(true);
+}
+
+CLAMIR_TEST(FrameRecordingScansCapturesWithoutIndex)
+{
+	std::string path = TestPath("unindexed.clmr"), cut = TestPath("cut.clmr");
+	WriteCapture(path, true);
+
+	// Drops the index and the footer, as a recording interrupted before Close
+	std::vector<char> bytes;
+	FILE* file = fopen(path.c_str(), "rb");
+	CHECK(file != 0);
+	if (file)
+	{
+		fseek(file, 0, SEEK_END);
+		bytes.resize((size_t)ftell(file));
+		fseek(file, 0, SEEK_SET);
+		CHECK(fread(bytes.data(), 1, bytes.size(), file) == bytes.size());
+		fclose(file);
+	}
+	RecordingFooter footer;
+	CHECK(bytes.size() > sizeof(footer));
+	if (bytes.size() > sizeof(footer))
+	{
+		memcpy(&footer, bytes.data() + bytes.size() - sizeof(footer), sizeof(footer));
+		CHECK(footer.FrameCount == frame_count && footer.IndexOffset < bytes.size());
+		file = fopen(cut.c_str(), "wb");
+		CHECK(file != 0);
+		if (file)
+		{
+			fwrite(bytes.data(), 1, (size_t)footer.IndexOffset, file);
+			fclose(file);
+		}
+	}
+
+	FrameRecording recording;
+	CHECK(recording.Open(cut.c_str()) == 0);
+	CHECK(recording.FrameCount() == frame_count);
+	CHECK(BadFrames(recording) == 0);
+	recording.Close();
+	RemoveTestFiles(path);
+	RemoveTestFiles(cut);
+}
+
+CLAMIR_TEST(FrameRecorderSpillsLongIndexes)
+{
+	// Past two spills of the 65536 entry index buffer, plus a partial buffer left in memory
+	const int long_count = 150000;
+	std::string path = TestPath("long.clmr");
+	{
+		FrameRecorder recorder;
+		CHECK(recorder.Open(path.c_str(), 1 << 20) == 0);
+		recorder.SetCompression(true);
+		static int16_t aImage[CLAMIR_IMAGE_PIXELS];
+		for (int frame = 0; frame < long_count; frame++)
+		{
+			ImageHeader header;
+			memset(&header, 0, sizeof(header));
+			header.FrameNum = frame;
+			aImage[0] = (int16_t)(frame % 1000);
+			CHECK(recorder.Append(header, aImage) == 0);
+		}
+		FILE* spill = fopen((path + ".index").c_str(), "rb");
+		CHECK(spill != 0);
+		if (spill)
+			fclose(spill);
+		CHECK(recorder.Close() == 0);
+	}
+	FILE* spill = fopen((path + ".index").c_str(), "rb");
+	CHECK(spill == 0);
+	if (spill)
+		fclose(spill);
+
+	FrameRecording recording;
+	CHECK(recording.Open(path.c_str()) == 0);
+	CHECK(recording.FrameCount() == long_count);
+	static int16_t aImage[CLAMIR_IMAGE_PIXELS];
+	int bad = 0;
+	for (int frame = 0; frame < long_count; frame++)
+	{
+		ImageHeader header;
+		if (recording.ReadFrame(frame, &header, aImage) != 0 || header.FrameNum != frame || aImage[0] != frame % 1000)
+			bad++;
+	}
+	CHECK(bad == 0);
+	recording.Close();
+	RemoveTestFiles(path);
+}
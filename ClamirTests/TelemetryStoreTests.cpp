@@ -0,0 +1,57 @@
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include "TestHarness.h"
+#include "TelemetryStore.h"
+
+namespace
+{
+	const int row_count = 3 * CLAMIR_TELEMETRY_CHUNK_ROWS + 100;
+	const int rows_per_track = 1000;
+}
+
+CLAMIR_TEST(TelemetryStoreRoundTripsColumns)
+{
+	std::string path = TestPath("store.telemetry");
+	TelemetryWriter writer;
+	CHECK(writer.Open(path.c_str()) == 0);
+	for (int row = 0; row < row_count; row++)
+	{
+		ImageHeader header;
+		memset(&header, 0, sizeof(header));
+		header.Power = row % 1000;
+		header.Width = row * 0.5f;
+		header.TrackNum = row / rows_per_track;
+		header.StateMachine = (char)(row % 3);
+		CHECK(writer.Append(header) == 0);
+	}
+	CHECK(writer.Close() == 0);
+
+	TelemetryStore store;
+	CHECK(store.Open(path.c_str()) == 0);
+	CHECK(store.RowCount() == row_count);
+	CHECK(store.ChunkCount() == 4);
+	for (uint64_t i = 0; i < store.ChunkCount(); i++)
+		CHECK((uintptr_t)store.Chunk(i) % 8 == 0);
+
+	std::vector<double> values(row_count);
+	CHECK(store.ReadColumn(TELEMETRY_WIDTH, 0, row_count, values.data()) == 0);
+	int bad = 0;
+	for (int row = 0; row < row_count; row++)
+		if (values[row] != row * 0.5f)
+			bad++;
+	CHECK(bad == 0);
+	CHECK(store.ReadColumn(TELEMETRY_POWER, row_count - 10, 10, values.data()) == 0);
+	CHECK(values[9] == (row_count - 1) % 1000);
+	CHECK(store.ReadColumn(TELEMETRY_POWER, row_count - 10, 11, values.data()) == -1);
+
+	// Track 7 lies in the second chunk only, so the min/max of the other chunks skip them
+	std::vector<uint64_t> rows;
+	uint64_t chunksRead = 0;
+	TelemetryCondition condition = TelemetryCompare(TELEMETRY_TRACK_NUM, TELEMETRY_EQ, 7);
+	CHECK(store.Query(&condition, 1, &rows, &chunksRead) == 0);
+	CHECK(rows.size() == rows_per_track && rows.front() == 7 * rows_per_track && rows.back() == 8 * rows_per_track - 1);
+	CHECK(chunksRead == 1);
+	store.Close();
+	RemoveTestFiles(path);
+}
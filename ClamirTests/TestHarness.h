@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+
+/** \file TestHarness.h
+*	Minimal test runner of ClamirTests. A test is a function declared with CLAMIR_TEST; CHECK prints the failed expressions and marks the running test as failed.
+*	Tests run one after the other in one process against ClamirSim, which replaces the CLAMIR DLL, so each test leaves the simulator disconnected with its link up.
+*/
+
+typedef void (*TestFunction)();
+
+struct TestRegistration
+{
+	TestRegistration(const char* name, TestFunction function);
+};
+
+void CheckFailed(const char* file, int line, const char* expression);
+
+/**
+@brief Path of a scratch file in the working directory, removed with RemoveTestFiles
+*/
+std::string TestPath(const char* name);
+
+/**
+@brief Removes a scratch file and the side files FrameRecorder writes next to it
+*/
+void RemoveTestFiles(const std::string& path);
+
+/**
+@brief Connects ClamirFunctions to the simulator
+@param frameRate Frames per second of the simulator, 0 to deliver frames as fast as they are requested
+@returns The code of ClamirFunctions::ConnectDevice
+*/
+int ConnectSimulator(float frameRate);
+
+#define CLAMIR_TEST(name) \
+	static void name(); \
+	static TestRegistration name##_registration(#name, name); \
+	static void name()
+
+#define CHECK(expression) \
+	do { if (!(expression)) CheckFailed(__FILE__, __LINE__, #expression); } while (0)
@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "TestHarness.h"
+#include "ClamirFunctions.h"
+#include "ClamirSim.h"
+
+namespace
+{
+	struct RegisteredTest
+	{
+		const char* Name;
+		TestFunction Function;
+	};
+
+	// Function local so registrations from other translation units do not depend on initialization order
+	std::vector<RegisteredTest>& Tests()
+	{
+		static std::vector<RegisteredTest> tests;
+		return tests;
+	}
+
+	int failed_checks = 0;
+}
+
+TestRegistration::TestRegistration(const char* name, TestFunction function)
+{
+	RegisteredTest test = { name, function };
+	Tests().push_back(test);
+}
+
+void CheckFailed(const char* file, int line, const char* expression)
+{
+	fprintf(stderr, "%s(%d): CHECK(%s) failed\n", file, line, expression);
+	failed_checks++;
+}
+
+std::string TestPath(const char* name)
+{
+	return std::string("clamir_test_") + name;
+}
+
+void RemoveTestFiles(const std::string& path)
+{
+	const char* const suffixes[] = { "", ".telemetry", ".transitions", ".index" };
+	for (const char* suffix : suffixes)
+		remove((path + suffix).c_str());
+}
+
+int ConnectSimulator(float frameRate)
+{
+	ClamirSimConfig config;
+	ClamirSimGetConfig(&config);
+	config.FrameRate = frameRate;
+	ClamirSimSetConfig(&config);
+	ClamirSimSetLink(1);
+	return ClamirFunctions::ConnectDevice();
+}
+
+/**
+@brief Runs every test, or those whose name contains the first argument
+@returns The number of failed tests
+*/
+int main(int argc, char** argv)
+{
+	const char* filter = argc > 1 ? argv[1] : "";
+	int run = 0, failed = 0;
+	for (const RegisteredTest& test : Tests())
+	{
+		if (!strstr(test.Name, filter))
+			continue;
+		int before = failed_checks;
+		test.Function();
+		bool passed = failed_checks == before;
+		printf("[%s] %s\n", passed ? "  OK  " : " FAIL ", test.Name);
+		run++;
+		if (!passed)
+			failed++;
+	}
+	printf("%d of %d tests passed\n", run - failed, run);
+	return failed;
+}
@@ -14,13 +14,18 @@ namespace ClamirView
     public partial class Form1 : Form
     {
         ClamirCLR.ClamirCLR clamirCLR = new ClamirCLR.ClamirCLR();
-        bool retry = true;
-        static int connection_result = 1;
-        static int connection_retry_n = 0;
+        // ConnectionState values of ConnectionManager.h
+        const int ConnectionConnecting = 1;
+        const int ConnectionConnected = 2;
+        const int ConnectionFailed = 3;
+        Timer connection_timer = new Timer();
+        int shown_state = -1;
 
         public Form1()
         {
             InitializeComponent();
+            connection_timer.Interval = 100;
+            connection_timer.Tick += connection_timer_Tick;
         }
 
         private void button1_Click(object sender, EventArgs e)
@@ -49,35 +54,36 @@ namespace ClamirView
 
         private void button5_Click(object sender, EventArgs e)
         {
-            MessageBox.Show("Clicked!");
-            while (retry)
+            // The native connection manager connects and reconnects in the background; the timer only reads its state
+            if (clamirCLR.StartConnection() == 0)
             {
-                MessageBox.Show("Try connection..");
-                connection_result = clamirCLR.ConnectDevice();
-                if (connection_result == 0)
-                {
-                    MessageBox.Show("Connected!");
-                    retry = false;
-                }
-                else
-                {
-                    if (connection_retry_n < 2)
-                    {
-                        connection_retry_n++;
-                        MessageBox.Show("Retrying again in a second. Try number ", connection_retry_n.ToString());
-                    }
-                    else
-                    {
-                        MessageBox.Show("Closing this application. Check if a CLAMIR system is connected to your network.");
-                        retry = false;
-                    }
-                }
+                shown_state = -1;
+                connection_timer.Start();
             }
         }
 
+        private void connection_timer_Tick(object sender, EventArgs e)
+        {
+            int state = clamirCLR.GetConnectionState();
+            if (state == shown_state)
+                return;
+            shown_state = state;
+            if (state == ConnectionConnected)
+                Text = "Form1 - connected";
+            else if (state == ConnectionConnecting)
+                Text = "Form1 - connecting...";
+            else if (state == ConnectionFailed)
+                Text = "Form1 - connection failed";
+            else
+                Text = "Form1";
+        }
+
         private void button6_Click(object sender, EventArgs e)
         {
-            clamirCLR.DisconnectDevice();
+            connection_timer.Stop();
+            if (clamirCLR.StopConnection() != 0)
+                clamirCLR.DisconnectDevice();
+            Text = "Form1";
         }
     }
 }
@@ -18,9 +18,13 @@
 
 #pragma once
 #include <stdint.h>
+#ifdef _WIN32
 #include <winsock.h>
+#endif
 
-#ifdef CLAMIRDLL_EXPORTS
+#ifndef _WIN32
+#define CLAMIRDLL_API
+#elif defined(CLAMIRDLL_EXPORTS)
 #define CLAMIRDLL_API __declspec(dllexport)
 #else
 #define CLAMIRDLL_API __declspec(dllimport)